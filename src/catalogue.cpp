@@ -0,0 +1,825 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "catalogue.h"
+#include "options.h"
+#include "log.h"
+
+#include <cstdio>
+#include <ctime>
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* bits of the flags column */
+#define FLAG_FAVOURITE 0x01
+#define FLAG_HIDE      0x02
+#define FLAG_MISSING   0x04
+#define FLAG_HIDDEN    (FLAG_HIDE | FLAG_MISSING)
+
+#define CACHE_FILE "catalogue.dat"
+#define CACHE_MAGIC "LLCATLG"
+#define CACHE_VERSION 3
+
+/* columns of string pool offsets, rom through clone_of */
+#define TEXT_COLUMNS 7
+
+/* marks an unused slot of the games by rom table */
+#define NO_GAME 0xffffffff
+
+using namespace ll;
+using namespace std;
+
+/** Orders games by name, used once to rank the names */
+struct cmp_name {
+   const catalogue* c;
+   cmp_name(const catalogue* c) : c(c) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   { return strcmp(c->name(left), c->name(right)) < 0; }
+};
+
+/**
+ * Orderings of the views, these match the ORDER BY clauses the views used
+ * to be queried with.
+ */
+struct cmp_order {
+   const catalogue* c;
+   cmp_order(const catalogue* c) : c(c) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   { return c->order(left) < c->order(right); }
+};
+
+struct cmp_count {
+   const catalogue* c;
+   cmp_count(const catalogue* c) : c(c) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   {
+      if (c->count(left) != c->count(right))
+         return c->count(left) < c->count(right);
+      return c->order(left) < c->order(right);
+   }
+};
+
+struct cmp_recent {
+   const catalogue* c;
+   cmp_recent(const catalogue* c) : c(c) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   {
+      if (c->last_played(left) != c->last_played(right))
+         return c->last_played(left) > c->last_played(right);
+      return c->order(left) < c->order(right);
+   }
+};
+
+/** Orders string pool offsets by their text */
+struct cmp_text {
+   const string_pool* pool;
+   cmp_text(const string_pool* pool) : pool(pool) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   { return strcmp(pool->get(left), pool->get(right)) < 0; }
+};
+
+/** Orders games by a column of string pool offsets */
+struct cmp_column {
+   const vector<Uint32>& column;
+   cmp_column(const vector<Uint32>& column) : column(column) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   { return column[left] < column[right]; }
+};
+
+/** True for games whose column is before an offset */
+struct before_offset {
+   const vector<Uint32>& column;
+   before_offset(const vector<Uint32>& column) : column(column) { }
+
+   bool operator()(Uint32 g, Uint32 offset) const
+   { return column[g] < offset; }
+};
+
+/** Sort key of a game in a view listed in sub menus */
+struct group_key {
+   Uint32 label; // alphabetic rank of the sub menu name
+   Uint32 group; // sub menu, separates sub menus with equal names
+   Uint32 order; // rank of the game within the sub menu
+   Uint32 game;
+
+   bool operator<(const group_key& other) const
+   {
+      if (label != other.label) return label < other.label;
+      if (group != other.group) return group < other.group;
+      return order < other.order;
+   }
+};
+
+/**
+ * Header of the cache file.  Sections follow it, each padded to a multiple
+ * of 8 bytes: the string pool data and hash table, the text columns, the
+ * order, last played, count and flags columns, the games of each view and
+ * the sub menus of each view.
+ */
+struct cache_header {
+   char magic[8];
+   Uint32 version;
+   Uint32 games;
+   Sint64 db_mtime; // games.db when the cache was saved
+   Sint64 db_size;
+   Sint64 wal_size; // size of games.db-wal, plays not checkpointed yet
+   Uint32 strings;  // bytes of string data
+   Uint32 slots;    // string pool hash table slots
+   Uint32 distinct; // strings in the pool
+   Uint32 views[VIEW_COUNT];  // games listed by each view
+   Uint32 groups[VIEW_COUNT]; // sub menus of each view
+};
+
+/** Starting slot of a rom offset in a table of the given mask */
+static inline Uint32 rom_slot(Uint32 rom, Uint32 mask)
+{ return (rom * 2654435761u) & mask; }
+
+static inline Uint64 pad8(Uint64 n)
+{ return (n + 7) & ~(Uint64)7; }
+
+/** Records the state of games.db in a cache header */
+static bool stamp_db(const string& db_file, cache_header& header)
+{
+   struct stat st;
+   if (stat(db_file.c_str(), &st) != 0)
+      return false;
+
+   header.db_mtime = st.st_mtime;
+   header.db_size = st.st_size;
+
+   string wal(db_file + "-wal");
+   header.wal_size = stat(wal.c_str(), &st) == 0? st.st_size : 0;
+
+   return true;
+}
+
+/** Returns true if n values are all below a limit */
+static bool below(const Uint32* values, Uint32 n, Uint32 limit)
+{
+   for (Uint32 i = 0; i < n; i++)
+      if (values[i] >= limit) return false;
+   return true;
+}
+
+/** Writes a section of the cache file padded to 8 bytes */
+static bool write_section(FILE* file, const void* data, Uint64 size)
+{
+   static const char zeros[8] = { 0 };
+   Uint64 pad = pad8(size) - size;
+
+   return (size == 0 || fwrite(data, size, 1, file) == 1) &&
+      (pad == 0 || fwrite(zeros, pad, 1, file) == 1);
+}
+
+template <class T>
+static bool write_section(FILE* file, const vector<T>& v)
+{ return write_section(file, v.empty()? NULL : &v[0], v.size() * sizeof(T)); }
+
+/** Copies a section of the cache file, moving past it */
+template <class T>
+static void read_section(const char*& pos, vector<T>& v, Uint32 n)
+{
+   v.assign((const T*)pos, (const T*)pos + n);
+   pos += pad8(n * sizeof(T));
+}
+
+/** Returns a text column, or an empty string for NULL */
+static const char* column_text(sqlite3_stmt* stmt, int col)
+{
+   const char* text = (const char*)sqlite3_column_text(stmt, col);
+   return text? text : "";
+}
+
+catalogue::catalogue(sqlite3* db, const string& db_file, bool quiet)
+      throw(bad_lemon&) :
+   _db_file(db_file), _cache_file(CACHE_FILE), _modified(false), _cached(false),
+   _db_mtime(-1), _db_size(-1), _wal_size(-1)
+{
+   Uint32 start = SDL_GetTicks();
+
+   g_opts.resolve(_cache_file);
+
+   if (load_cache(quiet)) {
+      _cached = true;
+      build_indexes();
+      if (!quiet)
+         log << info << "catalogue: loaded " << size() << " games ("
+             << bytes() / 1024 << "k) from " << _cache_file << " in "
+             << SDL_GetTicks() - start << "ms" << endl;
+      return;
+   }
+
+   // stamped before reading, a change while reading leaves the cache stale
+   cache_header now;
+   if (stamp_db(_db_file, now)) {
+      _db_mtime = now.db_mtime;
+      _db_size = now.db_size;
+      _wal_size = now.wal_size;
+   }
+
+   load(db);
+   build_indexes();
+
+   if (!quiet)
+      log << info << "catalogue: loaded " << size() << " games ("
+          << bytes() / 1024 << "k) in " << SDL_GetTicks() - start << "ms" << endl;
+}
+
+void catalogue::load(sqlite3* db) throw(bad_lemon&)
+{
+   sqlite3_stmt* stmt;
+
+   // size the columns up front so they are allocated once
+   if (sqlite3_prepare(db, "SELECT count(*) FROM games", -1, &stmt, NULL) == SQLITE_OK) {
+      if (sqlite3_step(stmt) == SQLITE_ROW) {
+         size_t rows = sqlite3_column_int(stmt, 0);
+         _rom.reserve(rows);
+         _name.reserve(rows);
+         _params.reserve(rows);
+         _genre.reserve(rows);
+         _year.reserve(rows);
+         _manufacturer.reserve(rows);
+         _clone_of.reserve(rows);
+         _count.reserve(rows);
+         _last_played.reserve(rows);
+         _flags.reserve(rows);
+      }
+      sqlite3_finalize(stmt);
+   }
+
+   if (sqlite3_prepare(db, "SELECT filename, name, params, genre, count, "
+         "favourite, hide, missing, year, manufacturer, clone_of, "
+         "strftime('%s', last_played) FROM games",
+         -1, &stmt, NULL) != SQLITE_OK)
+      throw bad_lemon(sqlite3_errmsg(db));
+
+   int rc;
+   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+      _rom.push_back(_strings.intern(column_text(stmt, 0)));
+      _name.push_back(_strings.intern(column_text(stmt, 1)));
+      _params.push_back(_strings.intern(column_text(stmt, 2)));
+      _genre.push_back(_strings.intern(column_text(stmt, 3)));
+      _count.push_back(sqlite3_column_int(stmt, 4));
+
+      const char* released = column_text(stmt, 8);
+      if (*released == '\0' || strcmp(released, "0") == 0)
+         released = "Unknown";
+      _year.push_back(_strings.intern(released));
+      _manufacturer.push_back(_strings.intern(column_text(stmt, 9)));
+      _clone_of.push_back(_strings.intern(column_text(stmt, 10)));
+      _last_played.push_back(sqlite3_column_int64(stmt, 11));
+
+      Uint8 flags = 0;
+      if (sqlite3_column_int(stmt, 5) == 1)
+         flags |= FLAG_FAVOURITE;
+      if (sqlite3_column_int(stmt, 6) != 0)
+         flags |= FLAG_HIDE;
+      if (sqlite3_column_int(stmt, 7) != 0)
+         flags |= FLAG_MISSING;
+      _flags.push_back(flags);
+   }
+
+   sqlite3_finalize(stmt);
+
+   if (rc != SQLITE_DONE)
+      throw bad_lemon(sqlite3_errmsg(db));
+
+   _strings.compact();
+
+   // rank the names once, views then sort on the rank alone
+   vector<Uint32> by_name(size());
+   for (Uint32 g = 0; g < size(); g++)
+      by_name[g] = g;
+   stable_sort(by_name.begin(), by_name.end(), cmp_name(this));
+
+   _order.resize(size());
+   for (Uint32 i = 0; i < size(); i++)
+      _order[by_name[i]] = i;
+
+   for (Uint32 g = 0; g < size(); g++) {
+      if (favourite(g))
+         _views[favorite].push_back(g);
+      if (count(g) > 0)
+         _views[most_played].push_back(g);
+      if (last_played(g) > 0)
+         _views[recently_played].push_back(g);
+   }
+
+   for (int v = 0; v < VIEW_COUNT; v++)
+      sort_view((view_t)v);
+}
+
+bool catalogue::load_cache(bool quiet)
+{
+#ifdef HAVE_SYS_MMAN_H
+   int fd = open(_cache_file.c_str(), O_RDONLY);
+   if (fd == -1)
+      return false;
+
+   struct stat st;
+   void* addr = MAP_FAILED;
+   if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(cache_header))
+      addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (addr == MAP_FAILED)
+      return false;
+
+   const char* data = (const char*)addr;
+   const Uint64 file_size = st.st_size;
+
+   cache_header header, now;
+   memcpy(&header, data, sizeof(header));
+
+   bool valid = strncmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.version == CACHE_VERSION && stamp_db(_db_file, now) &&
+      header.db_mtime == now.db_mtime && header.db_size == now.db_size &&
+      header.wal_size == now.wal_size;
+
+   // the sections must add up to the file size
+   const Uint32 n = header.games;
+   Uint64 expect = pad8(sizeof(header)) + pad8(header.strings) +
+      pad8((Uint64)header.slots * sizeof(Uint32)) +
+      TEXT_COLUMNS * pad8((Uint64)n * sizeof(Uint32)) +
+      2 * pad8((Uint64)n * sizeof(Uint32)) + pad8((Uint64)n * sizeof(int)) + pad8(n);
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      expect += pad8((Uint64)header.views[v] * sizeof(Uint32));
+      expect += pad8((Uint64)header.groups[v] * sizeof(group));
+   }
+
+   valid = valid && expect == file_size;
+
+   // offsets and indices must stay within the file's own data
+   const char* strings = data + pad8(sizeof(header));
+   const Uint32* table = (const Uint32*)(strings + pad8(header.strings));
+   const char* columns = (const char*)table + pad8((Uint64)header.slots * sizeof(Uint32));
+   const char* views = columns + TEXT_COLUMNS * pad8(n * sizeof(Uint32)) +
+      2 * pad8(n * sizeof(Uint32)) + pad8(n * sizeof(int)) + pad8(n);
+
+   if (valid) {
+      for (int c = 0; c < TEXT_COLUMNS && valid; c++)
+         valid = below((const Uint32*)(columns + c * pad8(n * sizeof(Uint32))),
+               n, header.strings);
+      valid = valid && below((const Uint32*)(columns +
+            TEXT_COLUMNS * pad8(n * sizeof(Uint32))), n, n);
+
+      const char* pos = views;
+      for (int v = 0; v < VIEW_COUNT && valid; v++) {
+         valid = below((const Uint32*)pos, header.views[v], n);
+         pos += pad8(header.views[v] * sizeof(Uint32));
+      }
+
+      for (int v = 0; v < VIEW_COUNT && valid; v++) {
+         const group* g = (const group*)pos;
+         for (Uint32 i = 0; i < header.groups[v] && valid; i++)
+            valid = g[i].name < header.strings && g[i].first < g[i].last &&
+               g[i].last <= header.views[v];
+         pos += pad8(header.groups[v] * sizeof(group));
+      }
+   }
+
+   if (valid)
+      valid = _strings.restore(strings, header.strings, table,
+            header.slots, header.distinct);
+
+   if (valid) {
+      const char* pos = columns;
+      vector<Uint32>* text[TEXT_COLUMNS] = {
+         &_rom, &_name, &_params, &_genre, &_year, &_manufacturer, &_clone_of
+      };
+
+      for (int c = 0; c < TEXT_COLUMNS; c++)
+         read_section(pos, *text[c], n);
+      read_section(pos, _order, n);
+      read_section(pos, _last_played, n);
+      read_section(pos, _count, n);
+      read_section(pos, _flags, n);
+
+      for (int v = 0; v < VIEW_COUNT; v++)
+         read_section(pos, _views[v], header.views[v]);
+      for (int v = 0; v < VIEW_COUNT; v++)
+         read_section(pos, _groups[v], header.groups[v]);
+   }
+
+   munmap(addr, st.st_size);
+
+   if (!valid && !quiet)
+      log << info << "catalogue: " << _cache_file << " is out of date" << endl;
+
+   return valid;
+#else
+   return false;
+#endif
+}
+
+void catalogue::save_cache()
+{
+#ifdef HAVE_SYS_MMAN_H
+   cache_header header;
+   memset(&header, 0, sizeof(header));
+   strncpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+   header.version = CACHE_VERSION;
+   header.games = size();
+
+   if (_modified) {
+      if (!stamp_db(_db_file, header))
+         return;
+   } else {
+      if (_db_mtime == -1)
+         return;
+
+      header.db_mtime = _db_mtime;
+      header.db_size = _db_size;
+      header.wal_size = _wal_size;
+   }
+
+   header.strings = _strings.data().size();
+   header.slots = _strings.table().size();
+   header.distinct = _strings.count();
+
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      header.views[v] = _views[v].size();
+      header.groups[v] = _groups[v].size();
+   }
+
+   // written aside and renamed, so a reader never sees part of a file
+   string tmp(_cache_file + ".tmp");
+   FILE* file = fopen(tmp.c_str(), "wb");
+   if (!file) {
+      log << warn << "catalogue: unable to write " << tmp << endl;
+      return;
+   }
+
+   const vector<Uint32>* text[TEXT_COLUMNS] = {
+      &_rom, &_name, &_params, &_genre, &_year, &_manufacturer, &_clone_of
+   };
+
+   bool ok = write_section(file, &header, sizeof(header)) &&
+      write_section(file, _strings.data()) &&
+      write_section(file, _strings.table());
+
+   for (int c = 0; c < TEXT_COLUMNS; c++)
+      ok = ok && write_section(file, *text[c]);
+
+   ok = ok && write_section(file, _order) && write_section(file, _last_played) &&
+      write_section(file, _count) &&
+      write_section(file, _flags);
+
+   for (int v = 0; v < VIEW_COUNT; v++)
+      ok = ok && write_section(file, _views[v]);
+   for (int v = 0; v < VIEW_COUNT; v++)
+      ok = ok && write_section(file, _groups[v]);
+
+   ok = fclose(file) == 0 && ok;
+
+   if (!ok || rename(tmp.c_str(), _cache_file.c_str()) != 0) {
+      log << warn << "catalogue: unable to write " << _cache_file << endl;
+      unlink(tmp.c_str());
+      return;
+   }
+
+   _modified = false;
+   _cached = true;
+   _db_mtime = header.db_mtime;
+   _db_size = header.db_size;
+   _wal_size = header.wal_size;
+#endif
+}
+
+size_t catalogue::bytes() const
+{
+   size_t n = _strings.bytes();
+
+   n += (_rom.capacity() + _name.capacity() + _params.capacity() +
+         _genre.capacity() + _year.capacity() + _manufacturer.capacity() +
+         _clone_of.capacity() + _order.capacity()) * sizeof(Uint32);
+   n += _count.capacity() * sizeof(int) + _flags.capacity();
+   n += _last_played.capacity() * sizeof(Uint32);
+   n += _by_rom.capacity() * sizeof(Uint32);
+
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      n += _views[v].capacity() * sizeof(Uint32);
+      n += _groups[v].capacity() * sizeof(group);
+      n += _group_of_game[v].capacity() * sizeof(Uint32);
+   }
+
+   return n;
+}
+
+void catalogue::build_indexes()
+{
+   // a power of two at least twice the games, so probes stay short
+   Uint32 slots = 16;
+   while (slots < size() * 2)
+      slots *= 2;
+
+   _by_rom.assign(slots, NO_GAME);
+   const Uint32 mask = slots - 1;
+
+   for (Uint32 g = 0; g < size(); g++) {
+      Uint32 i = rom_slot(_rom[g], mask);
+      while (_by_rom[i] != NO_GAME)
+         i = (i + 1) & mask;
+      _by_rom[i] = g;
+   }
+
+   // games of a group are a range of its view
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      const vector<group>& groups = _groups[v];
+      _group_of_game[v].clear();
+      if (groups.empty()) continue;
+
+      _group_of_game[v].assign(size(), NO_GAME);
+      for (Uint32 i = 0; i < groups.size(); i++)
+         for (Uint32 pos = groups[i].first; pos < groups[i].last; pos++)
+            _group_of_game[v][_views[v][pos]] = i;
+   }
+}
+
+bool catalogue::lookup(const string& rom, Uint32& g) const
+{
+   // roms are pooled, so a rom that isn't has no game
+   Uint32 offset;
+   if (_by_rom.empty() || !_strings.find(rom.c_str(), offset))
+      return false;
+
+   const Uint32 mask = _by_rom.size() - 1;
+   for (Uint32 i = rom_slot(offset, mask); _by_rom[i] != NO_GAME;
+         i = (i + 1) & mask) {
+      if (_rom[_by_rom[i]] == offset) {
+         g = _by_rom[i];
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool catalogue::favourite(Uint32 g) const
+{ return (_flags[g] & FLAG_FAVOURITE) != 0; }
+
+bool catalogue::hide(Uint32 g) const
+{ return (_flags[g] & FLAG_HIDE) != 0; }
+
+bool catalogue::hidden(Uint32 g) const
+{ return (_flags[g] & FLAG_HIDDEN) != 0; }
+
+void catalogue::set_favourite(Uint32 g, bool fav)
+{
+   if (favourite(g) == fav) return;
+
+   if (fav)
+      _flags[g] |= FLAG_FAVOURITE;
+   else
+      _flags[g] &= ~FLAG_FAVOURITE;
+
+   // insert or remove in place, the view stays sorted by name
+   vector<Uint32>& games = _views[favorite];
+   vector<Uint32>::iterator i = lower_bound(games.begin(), games.end(), g,
+         cmp_order(this));
+
+   if (fav)
+      games.insert(i, g);
+   else if (i != games.end() && *i == g)
+      games.erase(i);
+
+   _modified = true;
+}
+
+void catalogue::set_hide(Uint32 g, bool hide)
+{
+   bool was_hidden = hidden(g);
+
+   if (hide)
+      _flags[g] |= FLAG_HIDE;
+   else
+      _flags[g] &= ~FLAG_HIDE;
+
+   _modified = true;
+
+   if (hidden(g) == was_hidden)
+      return;
+
+   // keep the visible counts of the sub menus listing the game
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      int i = group_index((view_t)v, g);
+      if (i < 0) continue;
+
+      if (was_hidden)
+         _groups[v][i].visible++;
+      else
+         _groups[v][i].visible--;
+   }
+}
+
+bool catalogue::find_group(view_t view, Uint32 g, Uint32& first,
+      Uint32& visible) const
+{
+   int i = group_index(view, g);
+   if (i < 0)
+      return false;
+
+   first = _groups[view][i].first;
+   visible = _groups[view][i].visible;
+   return true;
+}
+
+int catalogue::group_index(view_t view, Uint32 g) const
+{
+   const vector<Uint32>& groups = _group_of_game[view];
+   return groups.empty() || groups[g] == NO_GAME ? -1 : (int)groups[g];
+}
+
+void catalogue::sort_view(view_t view)
+{
+   vector<Uint32>& games = _views[view];
+
+   switch (view) {
+   case favorite:
+      stable_sort(games.begin(), games.end(), cmp_order(this));
+      break;
+
+   case most_played:
+      stable_sort(games.begin(), games.end(), cmp_count(this));
+      break;
+
+   case recently_played:
+      stable_sort(games.begin(), games.end(), cmp_recent(this));
+      break;
+
+   default:
+      group_view(view);
+      break;
+   }
+}
+
+Uint32 catalogue::group_of(view_t view, Uint32 g) const
+{
+   switch (view) {
+   case genre:
+      return _genre[g];
+   case year:
+      return _year[g];
+   case manufacturer:
+      return _manufacturer[g];
+   case clone_family:
+      // a family is named by the rom of its parent
+      return _clone_of[g]? _clone_of[g] : _rom[g];
+   default:
+      return 0;
+   }
+}
+
+void catalogue::group_view(view_t view)
+{
+   const Uint32 n = size();
+
+   // sub menu of each game and the name of the sub menu
+   vector<Uint32> groups(n);
+   vector<Uint32> labels(n);
+   for (Uint32 g = 0; g < n; g++)
+      labels[g] = groups[g] = group_of(view, g);
+
+   if (view == clone_family) {
+      // families are named after their parent game when it is listed
+      vector<Uint32> by_rom(n);
+      for (Uint32 g = 0; g < n; g++)
+         by_rom[g] = g;
+      sort(by_rom.begin(), by_rom.end(), cmp_column(_rom));
+
+      for (Uint32 g = 0; g < n; g++) {
+         if (!_clone_of[g]) {
+            labels[g] = _name[g];
+            continue;
+         }
+
+         // roms are pooled, a listed parent has the same offset
+         vector<Uint32>::iterator p = lower_bound(by_rom.begin(),
+               by_rom.end(), groups[g], before_offset(_rom));
+         if (p != by_rom.end() && _rom[*p] == groups[g])
+            labels[g] = _name[*p];
+      }
+   }
+
+   // rank the distinct names, the games are then sorted by integers only
+   vector<Uint32> names(labels);
+   sort(names.begin(), names.end());
+   names.erase(unique(names.begin(), names.end()), names.end());
+   sort(names.begin(), names.end(), cmp_text(&_strings));
+
+   vector<pair<Uint32, Uint32> > ranks(names.size());
+   for (Uint32 i = 0; i < names.size(); i++)
+      ranks[i] = make_pair(names[i], i);
+   sort(ranks.begin(), ranks.end());
+
+   vector<group_key> keys(n);
+   for (Uint32 g = 0; g < n; g++) {
+      keys[g].label = lower_bound(ranks.begin(), ranks.end(),
+            make_pair(labels[g], (Uint32)0))->second;
+      keys[g].group = groups[g];
+      // parents before their clones
+      keys[g].order = (view == clone_family && _clone_of[g]? 0x80000000 : 0) | _order[g];
+      keys[g].game = g;
+   }
+
+   sort(keys.begin(), keys.end());
+
+   vector<Uint32>& games = _views[view];
+   games.resize(n);
+   _groups[view].clear();
+
+   for (Uint32 i = 0; i < n; i++) {
+      Uint32 g = games[i] = keys[i].game;
+
+      // start a new sub menu when the group changes
+      if (i == 0 || keys[i].group != keys[i-1].group ||
+            keys[i].label != keys[i-1].label) {
+         group grp;
+         grp.name = labels[g];
+         grp.first = i;
+         grp.visible = 0;
+         _groups[view].push_back(grp);
+      }
+
+      _groups[view].back().last = i + 1;
+      if (!hidden(g))
+         _groups[view].back().visible++;
+   }
+}
+
+menu* catalogue::build(view_t view, bool show_hidden) const
+{
+   const vector<Uint32>& games = _views[view];
+   menu* top = new menu(view_names[view], this);
+
+   if (!_groups[view].empty()) {
+      // sub menus only describe their games until they are entered
+      for (vector<group>::const_iterator i = _groups[view].begin();
+            i != _groups[view].end(); i++) {
+         if (show_hidden || i->visible > 0)
+            top->add_menu(new menu(_strings.get(i->name), this, games,
+                  i->first, i->last, show_hidden));
+      }
+
+      return top;
+   }
+
+   top->reserve(games.size());
+
+   for (vector<Uint32>::const_iterator i = games.begin(); i != games.end(); i++) {
+      if (show_hidden || !hidden(*i))
+         top->add_game(*i);
+   }
+
+   return top;
+}
+
+void catalogue::played(Uint32 g)
+{
+   _count[g]++;
+   _modified = true;
+
+   // the most recent play goes to the front, the rest keep their order
+   vector<Uint32>& recent = _views[recently_played];
+   if (_last_played[g] > 0)
+      recent.erase(find(recent.begin(), recent.end(), g));
+   recent.insert(recent.begin(), g);
+   _last_played[g] = time(NULL);
+
+   // first play puts the game in the most played view
+   if (_count[g] == 1)
+      _views[most_played].push_back(g);
+
+   sort_view(most_played);
+}
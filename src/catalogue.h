@@ -0,0 +1,249 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CATALOGUE_H_
+#define CATALOGUE_H_
+
+#include <SDL/SDL.h>
+#include <sqlite3.h>
+#include <vector>
+#include <string>
+
+#include "stringpool.h"
+#include "menu.h"
+#include "error.h"
+
+using namespace std;
+
+namespace ll {
+
+typedef enum {
+   favorite, most_played, recently_played, genre, year, manufacturer,
+   clone_family
+} view_t;
+static const char* view_names[] = {
+      "Favorites", "Most Played", "Recently Played", "Genres", "Years",
+      "Manufacturers", "Clones"
+};
+
+/* number of views in view_t */
+#define VIEW_COUNT 7
+
+/**
+ * All games in games.db, loaded once at startup.  Games are referred to by
+ * their index and stored a column per field, with all text in one string
+ * pool.  Each view keeps the indices of the games it lists in display
+ * order, so switching views only has to lay out menus over them.
+ *
+ * Views listed in sub menus (genre, year, manufacturer and clone family)
+ * also keep the range of each sub menu, the sub menus are built as ranges
+ * and only list their games when entered.  These views are sorted once by
+ * integer keys: the alphabetic rank of the sub menu name, then the rank of
+ * the game name.
+ *
+ * Everything above is saved to catalogue.dat in the conf dir, along with
+ * the modification time and size of games.db.  While games.db is unchanged
+ * the catalogue is read back from that file instead of being queried and
+ * sorted again.
+ */
+class catalogue {
+private:
+   string _db_file;    // games.db, the cache is only valid while it's unchanged
+   string _cache_file; // catalogue.dat
+   bool _modified;     // games changed since loading or saving the cache
+   bool _cached;       // the cache file holds the games as loaded
+   Sint64 _db_mtime;   // games.db when the games were read from it,
+   Sint64 _db_size;    // -1 if it couldn't be checked
+   Sint64 _wal_size;
+
+   string_pool _strings;
+
+   /* one entry per game, text columns are offsets into _strings */
+   vector<Uint32> _rom;
+   vector<Uint32> _name;
+   vector<Uint32> _params;
+   vector<Uint32> _genre;
+   vector<Uint32> _year;
+   vector<Uint32> _manufacturer;
+   vector<Uint32> _clone_of; // rom of the parent, 0 if not a clone
+   vector<int> _count;
+   vector<Uint8> _flags;
+   vector<Uint32> _order;    // rank of the game's name in alphabetic order
+   vector<Uint32> _last_played; // seconds since the epoch, 0 if never played
+
+   vector<Uint32> _views[VIEW_COUNT]; // games of each view in display order
+
+   /* open addressed hash table of games keyed on their rom offset */
+   vector<Uint32> _by_rom;
+
+   /* a sub menu of a view, the games [first, last) of the view */
+   struct group {
+      Uint32 name;    // offset of the sub menu name in _strings
+      Uint32 first;
+      Uint32 last;
+      Uint32 visible; // games that aren't hidden
+   };
+   vector<group> _groups[VIEW_COUNT]; // sub menus of each view, if any
+   vector<Uint32> _group_of_game[VIEW_COUNT]; // group of each game, by view
+
+   /** Loads all games from the database and sorts the views */
+   void load(sqlite3* db) throw(bad_lemon&);
+
+   /**
+    * Reads the catalogue from the cache file.
+    * @param quiet don't log an outdated cache
+    * @return false if the file is missing, outdated or damaged
+    */
+   bool load_cache(bool quiet);
+
+   /** Fills the table of games by rom and the group of each game */
+   void build_indexes();
+
+   /** Sorts the games of a view into display order */
+   void sort_view(view_t view);
+
+   /** Returns the sub menu a game is listed in by a view, as a pool offset */
+   Uint32 group_of(view_t view, Uint32 g) const;
+
+   /** Sorts the games of a view listed in sub menus and splits them up */
+   void group_view(view_t view);
+
+   /** Returns the group of a view listing a game, -1 if there is none */
+   int group_index(view_t view, Uint32 g) const;
+
+public:
+   /**
+    * Loads all games, from the cache file when it matches the database or
+    * else from the database.  The cache isn't saved, that's left to the
+    * owner (see modified).
+    * @param db_file path of the database, to check the cache against
+    * @param quiet log nothing, for loading on a thread other than the
+    * interface's (the log isn't thread safe)
+    */
+   catalogue(sqlite3* db, const string& db_file, bool quiet = false)
+         throw(bad_lemon&);
+
+   /**
+    * Returns true if the cache file doesn't hold the games as they are,
+    * because they were read from the database or changed since.
+    */
+   bool modified() const
+   { return _modified || !_cached; }
+
+   /**
+    * Saves the catalogue to the cache file.  Games that haven't changed
+    * since being read are saved against games.db as it was then, so the
+    * cache can be saved any time after loading.  Once games have changed,
+    * call this only while the catalogue matches games.db, such as after
+    * its changes were written.
+    */
+   void save_cache();
+
+   /** Returns the number of games */
+   Uint32 size() const
+   { return _rom.size(); }
+
+   /** Returns the number of bytes used by game records */
+   size_t bytes() const;
+
+   /**
+    * Looks up a game by rom name.
+    * @return false if there is no such game
+    */
+   bool lookup(const string& rom, Uint32& g) const;
+
+   /** Returns the rom name of a game */
+   const char* rom(Uint32 g) const
+   { return _strings.get(_rom[g]); }
+
+   /** Returns the display name of a game */
+   const char* name(Uint32 g) const
+   { return _strings.get(_name[g]); }
+
+   /** Returns game specific mame parameters, empty if none */
+   const char* params(Uint32 g) const
+   { return _strings.get(_params[g]); }
+
+   /** Returns the genre a game is listed under in the genre view */
+   const char* genre_name(Uint32 g) const
+   { return _strings.get(_genre[g]); }
+
+   /** Returns the year a game was released, "Unknown" if not known */
+   const char* year_name(Uint32 g) const
+   { return _strings.get(_year[g]); }
+
+   /** Returns the manufacturer of a game */
+   const char* manufacturer_name(Uint32 g) const
+   { return _strings.get(_manufacturer[g]); }
+
+   /** Returns the rom name of the game this is a clone of, empty if none */
+   const char* clone_of(Uint32 g) const
+   { return _strings.get(_clone_of[g]); }
+
+   /** Returns the position of a game in alphabetic order of names */
+   Uint32 order(Uint32 g) const
+   { return _order[g]; }
+
+   /** Returns number of times a game has been played */
+   int count(Uint32 g) const
+   { return _count[g]; }
+
+   /** Returns when a game was last played, 0 if never */
+   Uint32 last_played(Uint32 g) const
+   { return _last_played[g]; }
+
+   /** Returns true if a game is a favourite */
+   bool favourite(Uint32 g) const;
+
+   /** Returns true if the hide flag of a game is set */
+   bool hide(Uint32 g) const;
+
+   /** Returns true if a game is hidden or missing */
+   bool hidden(Uint32 g) const;
+
+   /** Sets the favourite flag of a game, updating the favourites view */
+   void set_favourite(Uint32 g, bool fav);
+
+   /** Sets the hide flag of a game */
+   void set_hide(Uint32 g, bool hide);
+
+   /**
+    * Finds the sub menu of a view a game is listed in.
+    * @param first set to where the sub menu's games start in the view
+    * @param visible set to the number of its games that aren't hidden
+    * @return false if the view has no sub menus
+    */
+   bool find_group(view_t view, Uint32 g, Uint32& first, Uint32& visible) const;
+
+   /**
+    * Builds the menu tree of a view.
+    * @param show_hidden list hidden and missing games too
+    */
+   menu* build(view_t view, bool show_hidden) const;
+
+   /**
+    * Counts a play of a game, updating the most played view and moving the
+    * game to the front of the recently played view
+    */
+   void played(Uint32 g);
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "gamedb.h"
+#include "catalogue.h"
+#include "options.h"
+#include "log.h"
+
+/* milliseconds to wait for a lock held by another process */
+#define BUSY_TIMEOUT 5000
+
+/* milliseconds between checks for changes by other programs */
+#define POLL_INTERVAL 2000
+
+using namespace ll;
+using namespace std;
+
+game_db::game_db() throw(bad_lemon&) :
+   _file("games.db"), _db(NULL), _played(NULL), _favourite(NULL), _hide(NULL),
+   _version(NULL),
+   _data_version(0), _writer(NULL), _quit(false), _failed(0), _reloaded(NULL)
+{
+   // locate games.db file in confdir
+   g_opts.resolve(_file);
+
+   if (sqlite3_open(_file.c_str(), &_db)) {
+      string msg(sqlite3_errmsg(_db));
+      sqlite3_close(_db);
+      throw bad_lemon(msg.c_str());
+   }
+
+   sqlite3_busy_timeout(_db, BUSY_TIMEOUT);
+
+   // with a write ahead log commits don't wait on readers, and only
+   // checkpoints need to sync
+   if (sqlite3_exec(_db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL) != SQLITE_OK ||
+         sqlite3_exec(_db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL) != SQLITE_OK)
+      log << warn << "game_db: unable to enable WAL mode: "
+          << sqlite3_errmsg(_db) << endl;
+
+   if (sqlite3_prepare(_db, "UPDATE games SET count = count+1, "
+         "last_played = datetime(?, 'unixepoch') WHERE filename = ?",
+         -1, &_played, NULL) != SQLITE_OK ||
+         sqlite3_prepare(_db, "UPDATE games SET favourite = ? WHERE filename = ?",
+         -1, &_favourite, NULL) != SQLITE_OK ||
+         sqlite3_prepare(_db, "UPDATE games SET hide = ? WHERE filename = ?",
+         -1, &_hide, NULL) != SQLITE_OK) {
+      string msg(sqlite3_errmsg(_db));
+      sqlite3_finalize(_played);
+      sqlite3_finalize(_favourite);
+      sqlite3_close(_db);
+      throw bad_lemon(msg.c_str());
+   }
+
+   // without data_version (before sqlite 3.8.8) changes aren't noticed
+   if (sqlite3_prepare(_db, "PRAGMA data_version", -1, &_version, NULL) == SQLITE_OK) {
+      if (sqlite3_step(_version) == SQLITE_ROW)
+         _data_version = sqlite3_column_int(_version, 0);
+      sqlite3_reset(_version);
+   } else {
+      _version = NULL;
+   }
+
+   _lock = SDL_CreateMutex();
+   _wake = SDL_CreateCond();
+   _writer = SDL_CreateThread(&game_db::writer, this);
+
+   if (!_writer)
+      log << warn << "game_db: unable to start writer thread, "
+          << "writing synchronously" << endl;
+}
+
+game_db::~game_db()
+{
+   stop_writer();
+
+   if (_failed)
+      log << warn << "game_db: " << _failed << " changes were not saved" << endl;
+
+   delete _reloaded;
+
+   SDL_DestroyCond(_wake);
+   SDL_DestroyMutex(_lock);
+
+   sqlite3_finalize(_version);
+   sqlite3_finalize(_hide);
+   sqlite3_finalize(_favourite);
+   sqlite3_finalize(_played);
+   sqlite3_close(_db);
+}
+
+void game_db::stop_writer()
+{
+   if (!_writer)
+      return;
+
+   SDL_mutexP(_lock);
+   _quit = true;
+   SDL_CondSignal(_wake);
+   SDL_mutexV(_lock);
+
+   // the writer empties the queue before exiting
+   SDL_WaitThread(_writer, NULL);
+   _writer = NULL;
+}
+
+bool game_db::finish()
+{
+   stop_writer();
+
+   // without data_version other programs' changes can't be ruled out
+   if (!_version || _failed || _reloaded)
+      return false;
+
+   int version = _data_version + 1;
+   if (sqlite3_step(_version) == SQLITE_ROW)
+      version = sqlite3_column_int(_version, 0);
+   sqlite3_reset(_version);
+
+   return version == _data_version;
+}
+
+void game_db::played(const char* rom)
+{
+   queue(_played, rom, time(NULL));
+}
+
+void game_db::set_favourite(const char* rom, bool fav)
+{
+   queue(_favourite, rom, fav? 1 : 0);
+}
+
+void game_db::set_hide(const char* rom, bool hide)
+{
+   queue(_hide, rom, hide? 1 : 0);
+}
+
+void game_db::queue(sqlite3_stmt* stmt, const char* rom, Sint64 value)
+{
+   change c;
+   c.stmt = stmt;
+   c.rom = rom;
+   c.value = value;
+
+   if (!_writer) {
+      deque<change> changes(1, c);
+      write(changes);
+      return;
+   }
+
+   SDL_mutexP(_lock);
+   _queue.push_back(c);
+   SDL_CondSignal(_wake);
+   SDL_mutexV(_lock);
+}
+
+catalogue* game_db::take_catalogue()
+{
+   SDL_mutexP(_lock);
+   catalogue* c = _reloaded;
+   _reloaded = NULL;
+   SDL_mutexV(_lock);
+
+   return c;
+}
+
+void game_db::write(deque<change>& changes)
+{
+   bool transaction =
+      sqlite3_exec(_db, "BEGIN", NULL, NULL, NULL) == SQLITE_OK;
+
+   for (deque<change>::iterator i = changes.begin(); i != changes.end(); i++) {
+      sqlite3_bind_int64(i->stmt, 1, i->value);
+      sqlite3_bind_text(i->stmt, 2, i->rom.c_str(), -1, SQLITE_TRANSIENT);
+
+      if (sqlite3_step(i->stmt) != SQLITE_DONE)
+         _failed++;
+
+      sqlite3_reset(i->stmt);
+   }
+
+   if (transaction && sqlite3_exec(_db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+      sqlite3_exec(_db, "ROLLBACK", NULL, NULL, NULL);
+      _failed += changes.size();
+   }
+
+   changes.clear();
+}
+
+void game_db::run()
+{
+   deque<change> changes;
+
+   SDL_mutexP(_lock);
+
+   while (!_quit || !_queue.empty()) {
+      if (_queue.empty()) {
+         // wake up now and then to look for changes by other programs
+         if (SDL_CondWaitTimeout(_wake, _lock, POLL_INTERVAL) == SDL_MUTEX_TIMEDOUT) {
+            SDL_mutexV(_lock);
+            poll();
+            SDL_mutexP(_lock);
+         }
+         continue;
+      }
+
+      // take everything queued, it all goes in one transaction
+      changes.swap(_queue);
+
+      SDL_mutexV(_lock);
+      write(changes);
+      SDL_mutexP(_lock);
+   }
+
+   SDL_mutexV(_lock);
+}
+
+void game_db::poll()
+{
+   if (!_version)
+      return;
+
+   // data_version doesn't change with this connection's own writes
+   int version = _data_version;
+   if (sqlite3_step(_version) == SQLITE_ROW)
+      version = sqlite3_column_int(_version, 0);
+   sqlite3_reset(_version);
+
+   if (version == _data_version)
+      return;
+
+   catalogue* c;
+   try {
+      c = new catalogue(_db, _file, true); // logged when it's taken
+   } catch (bad_lemon&) {
+      // most likely caught in the middle of an update, try again later
+      return;
+   }
+
+   _data_version = version;
+
+   SDL_mutexP(_lock);
+   delete _reloaded; // never taken, this one is newer
+   _reloaded = c;
+   SDL_mutexV(_lock);
+
+   SDL_Event evt;
+   evt.type = SDL_USEREVENT;
+   evt.user.code = CATALOGUE_CHANGED_EVENT;
+   SDL_PushEvent(&evt);
+}
+
+int game_db::writer(void* data)
+{
+   ((game_db*)data)->run();
+   return 0;
+}
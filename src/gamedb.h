@@ -0,0 +1,146 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GAMEDB_H_
+#define GAMEDB_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <sqlite3.h>
+#include <string>
+#include <deque>
+#include <time.h>
+
+#include "error.h"
+
+/* user event code pushed when a reloaded catalogue is ready */
+#define CATALOGUE_CHANGED_EVENT 4
+
+using namespace std;
+
+namespace ll {
+
+class catalogue;
+
+/**
+ * The games.db connection.  Play statistics and flag changes are written
+ * behind by a background thread, so the interface never waits on the disk.
+ * Writes queued while the thread is busy are committed together in one
+ * transaction.
+ *
+ * The connection is opened in WAL mode so writes don't block readers.
+ *
+ * While idle the thread also polls the database for changes made by other
+ * programs (like lemontool).  The catalogue is then loaded again on the
+ * thread and a CATALOGUE_CHANGED_EVENT user event is pushed, the new
+ * catalogue is collected with take_catalogue().  Its cache isn't saved on
+ * the thread, that's up to whoever takes it.
+ */
+class game_db {
+private:
+   string _file; // path of games.db
+   sqlite3* _db;
+   sqlite3_stmt* _played; // bumps count and sets last_played of a rom
+   sqlite3_stmt* _favourite; // sets the favourite flag of a rom
+   sqlite3_stmt* _hide;      // sets the hide flag of a rom
+   sqlite3_stmt* _version; // data_version, changes with other connections' commits
+   int _data_version;      // data_version the catalogue was loaded at
+
+   SDL_Thread* _writer;
+   SDL_mutex* _lock;
+   SDL_cond* _wake;
+   bool _quit;
+
+   /* a change waiting to be written, the statement takes value then rom */
+   struct change {
+      sqlite3_stmt* stmt;
+      string rom;
+      Sint64 value; // time played, or the new flag
+   };
+   deque<change> _queue;
+
+   int _failed; // writes that failed, reported when closing
+
+   catalogue* _reloaded; // catalogue loaded after a change, not taken yet
+
+   /** Queues a change for the writer thread */
+   void queue(sqlite3_stmt* stmt, const char* rom, Sint64 value);
+
+   /** Writes the queued changes in one transaction */
+   void write(deque<change>& changes);
+
+   /** Loads the catalogue again if another program changed the database */
+   void poll();
+
+   /** Writes anything still queued and ends the writer thread */
+   void stop_writer();
+
+   /** Writer thread main loop */
+   void run();
+
+   /** Thread entry point, data is the game_db */
+   static int writer(void* data);
+
+public:
+   /** Opens games.db in the conf dir and starts the writer thread */
+   game_db() throw(bad_lemon&);
+
+   /** Writes anything still queued and closes the database */
+   ~game_db();
+
+   /**
+    * Writes anything still queued and stops the writer thread, later
+    * changes are written right away.
+    * @return true if games.db holds exactly the taken catalogue's games
+    * with the queued changes, false if it may not (another program
+    * changed it, a write failed or a reload wasn't taken)
+    */
+   bool finish();
+
+   /**
+    * Returns the connection for reading.  Statements run on it must be
+    * finished before returning to the main loop.
+    */
+   sqlite3* handle() const
+   { return _db; }
+
+   /** Returns the path of games.db */
+   const string& file() const
+   { return _file; }
+
+   /** Queues a play of a rom to be counted */
+   void played(const char* rom);
+
+   /** Queues a change of the favourite flag of a rom */
+   void set_favourite(const char* rom, bool fav);
+
+   /** Queues a change of the hide flag of a rom */
+   void set_hide(const char* rom, bool hide);
+
+   /**
+    * Takes the catalogue loaded after the database changed, the caller
+    * owns it.
+    * @return NULL if nothing changed since the last call
+    */
+   catalogue* take_catalogue();
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "inputwatch.h"
+
+#include <SDL/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef HAVE_LINUX_INPUT_H
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+/* event devices looked for, /dev/input/event0 and up */
+#define MAX_DEVICES 32
+
+using namespace ll;
+using namespace std;
+
+input_watch::input_watch()
+{
+#ifdef HAVE_LINUX_INPUT_H
+   for (int i = 0; i < MAX_DEVICES; i++) {
+      char dev[32];
+      sprintf(dev, "/dev/input/event%d", i);
+
+      device d;
+      d.fd = open(dev, O_RDONLY | O_NONBLOCK);
+      if (d.fd == -1)
+         continue;
+
+      read_axes(d);
+      _devices.push_back(d);
+   }
+#endif
+}
+
+input_watch::~input_watch()
+{
+#ifdef HAVE_LINUX_INPUT_H
+   for (vector<device>::iterator i = _devices.begin(); i != _devices.end(); i++)
+      close(i->fd);
+#endif
+}
+
+void input_watch::read_axes(device& dev)
+{
+#ifdef HAVE_LINUX_INPUT_H
+   const int bits = 8 * sizeof(unsigned long);
+   unsigned long has[(ABS_MAX + bits) / bits] = { 0 };
+   if (ioctl(dev.fd, EVIOCGBIT(EV_ABS, sizeof(has)), has) <= 0)
+      return;
+
+   axis none = { 0, 0 };
+   dev.axes.assign(ABS_MAX + 1, none);
+
+   for (int code = 0; code <= ABS_MAX; code++) {
+      if (!(has[code / bits] & (1UL << (code % bits))))
+         continue;
+
+      input_absinfo info;
+      if (ioctl(dev.fd, EVIOCGABS(code), &info) == -1)
+         continue;
+
+      dev.axes[code].value = info.value;
+      dev.axes[code].slack = info.flat > info.fuzz? info.flat : info.fuzz;
+   }
+#endif
+}
+
+bool input_watch::wait(int ms, int key, bool& held)
+{
+#ifdef HAVE_LINUX_INPUT_H
+   if (!_devices.empty()) {
+      vector<pollfd> polls(_devices.size());
+      for (size_t i = 0; i < _devices.size(); i++) {
+         polls[i].fd = _devices[i].fd;
+         polls[i].events = POLLIN;
+         polls[i].revents = 0;
+      }
+
+      if (poll(&polls[0], polls.size(), ms) <= 0)
+         return false;
+
+      bool input = false;
+      for (size_t i = polls.size(); i-- > 0; ) {
+         // stop watching unplugged devices, they'd never stop polling
+         if (polls[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            close(_devices[i].fd);
+            _devices.erase(_devices.begin() + i);
+            continue;
+         }
+
+         if (!(polls[i].revents & POLLIN))
+            continue;
+
+         vector<axis>& axes = _devices[i].axes;
+         input_event events[64];
+         ssize_t n;
+         while ((n = read(polls[i].fd, events, sizeof(events))) > 0) {
+            for (size_t e = 0; e < n / sizeof(input_event); e++) {
+               const input_event& ev = events[e];
+
+               if (ev.type == EV_KEY) {
+                  input = true;
+                  if (key && ev.code == key)
+                     held = ev.value != 0; // 2 is a repeat
+               } else if (ev.type == EV_REL) {
+                  input = true;
+               } else if (ev.type == EV_ABS && ev.code < axes.size()) {
+                  // moving within the slack of where it last counted is
+                  // jitter, however many events it takes
+                  axis& a = axes[ev.code];
+                  if (abs(ev.value - a.value) > a.slack) {
+                     a.value = ev.value;
+                     input = true;
+                  }
+               }
+            }
+         }
+      }
+
+      return input;
+   }
+#endif
+
+   SDL_Delay(ms);
+   return false;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef INPUTWATCH_H_
+#define INPUTWATCH_H_
+
+#include <vector>
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Watches the input devices while another program has the display, so the
+ * launcher can tell whether anyone is playing and notice its kill key.  The
+ * linux event devices are read alongside the program using them, nothing
+ * is taken away from it.  Key presses, buttons, trackballs and spinners
+ * count as input, and so do absolute axes (sticks, wheels, pedals, light
+ * guns) once they move further than the flat and fuzz the driver reports
+ * for them, so an axis jittering on its own doesn't.
+ *
+ * Needs linux/input.h and read access to /dev/input/event*, otherwise
+ * nothing is watched.
+ */
+class input_watch {
+private:
+   /* an absolute axis of a device */
+   struct axis {
+      int value; // position the axis last counted as input at
+      int slack; // movement that doesn't count, the larger of flat and fuzz
+   };
+
+   /* an open event device */
+   struct device {
+      int fd;
+      vector<axis> axes; // by axis code, empty without absolute axes
+   };
+
+   vector<device> _devices;
+
+   /** Reads the absolute axes of a device */
+   static void read_axes(device& dev);
+
+public:
+   /** Opens the event devices */
+   input_watch();
+
+   /** Closes the event devices */
+   ~input_watch();
+
+   /** Returns the number of devices being watched */
+   size_t devices() const
+   { return _devices.size(); }
+
+   /**
+    * Waits for input.
+    * @param ms milliseconds to wait at most
+    * @param key linux key code to track, 0 for none
+    * @param held set to whether the key is down
+    * @return true if there was input
+    */
+   bool wait(int ms, int key, bool& held);
+};
+
+} // end namespace
+
+#endif
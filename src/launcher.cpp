@@ -0,0 +1,413 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "launcher.h"
+#include "inputwatch.h"
+#include "catalogue.h"
+#include "options.h"
+#include "log.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef HAVE_SPAWN_H
+#include <spawn.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+
+extern char** environ;
+#endif
+
+/* milliseconds between checks on the emulator */
+#define SUPERVISE_INTERVAL 50
+
+/* milliseconds the kill key has to be held */
+#define KILL_HOLD 2000
+
+/* milliseconds the emulator gets to exit before it is killed outright */
+#define KILL_GRACE 3000
+
+using namespace ll;
+using namespace std;
+
+launcher::launcher() throw(bad_lemon&) :
+   _command(g_opts.get_string(KEY_MAME_PATH)),
+   _spawn(g_opts.get_int(KEY_LAUNCH_MODE) == LAUNCH_SPAWN),
+   _startup_timeout(g_opts.get_int(KEY_STARTUP_TIMEOUT) * 1000),
+   _idle_timeout(g_opts.get_int(KEY_IDLE_TIMEOUT) * 1000),
+   _kill_key(g_opts.get_int(KEY_KILL_KEY))
+{
+#ifndef HAVE_SPAWN_H
+   if (_spawn) {
+      log << warn << "launcher: spawn launch mode not supported, "
+          << "using system" << endl;
+      _spawn = false;
+   }
+#endif
+
+   // without a shell redirections, variables and the like would be passed
+   // to the emulator as they are
+   vector<string> args;
+   split(_command, args);
+   if (_spawn && (_command.find_first_of("|&;<>()$`*?~") != string::npos ||
+         (!args.empty() && args[0].find('=') != string::npos))) {
+      log << warn << "launcher: mame command needs a shell, using system "
+          << "launch mode" << endl;
+      _spawn = false;
+   }
+
+   compile(_command);
+}
+
+void launcher::compile(const string& cmd) throw(bad_lemon&)
+{
+   vector<string> args;
+   split(cmd, args);
+
+   if (args.empty())
+      throw bad_lemon("mame command is empty");
+
+   bool has_rom = false;
+
+   for (vector<string>::iterator a = args.begin(); a != args.end(); a++) {
+      arg_t arg;
+      piece text = { 0, "" };
+
+      for (string::iterator c = a->begin(); c != a->end(); c++) {
+         if (*c != '%') {
+            text.text += *c;
+            continue;
+         }
+
+         char spec = c+1 != a->end()? *++c : 0;
+         if (spec == '%') {
+            text.text += '%';
+            continue;
+         }
+
+         if (spec != 'r' && spec != 'p' && spec != 'g' && spec != 'n')
+            throw bad_lemon("mame command has an unknown % specifier");
+
+         has_rom |= spec == 'r';
+
+         if (!text.text.empty()) {
+            arg.push_back(text);
+            text.text.clear();
+         }
+
+         piece value = { spec, "" };
+         arg.push_back(value);
+      }
+
+      if (!text.text.empty() || arg.empty())
+         arg.push_back(text);
+
+      _template.push_back(arg);
+   }
+
+   if (!has_rom)
+      throw bad_lemon("mame path missing %r specifier");
+}
+
+void launcher::expand(const catalogue& games, Uint32 g,
+      vector<string>& args) const
+{
+   args.clear();
+
+   for (vector<arg_t>::const_iterator a = _template.begin(); a != _template.end(); a++) {
+      // params on their own are any number of arguments, maybe none
+      if (a->size() == 1 && a->front().spec == 'p') {
+         split(games.params(g), args);
+         continue;
+      }
+
+      string arg;
+      for (arg_t::const_iterator p = a->begin(); p != a->end(); p++) {
+         switch (p->spec) {
+         case 'r': arg += games.rom(g); break;
+         case 'p': arg += games.params(g); break;
+         case 'g': arg += games.genre_name(g); break;
+         case 'n': arg += games.name(g); break;
+         default:  arg += p->text;
+         }
+      }
+
+      args.push_back(arg);
+   }
+}
+
+string launcher::command(const catalogue& games, Uint32 g) const
+{
+   string cmd;
+
+   for (string::const_iterator c = _command.begin(); c != _command.end(); c++) {
+      if (*c != '%' || c+1 == _command.end()) {
+         cmd += *c;
+         continue;
+      }
+
+      switch (*++c) {
+      case 'r': cmd += quote(games.rom(g)); break;
+      case 'g': cmd += quote(games.genre_name(g)); break;
+      case 'n': cmd += quote(games.name(g)); break;
+      case 'p': {
+         // each param stays an argument of its own, like in spawn mode
+         vector<string> params;
+         split(games.params(g), params);
+         for (vector<string>::iterator p = params.begin(); p != params.end(); p++) {
+            if (p != params.begin()) cmd += ' ';
+            cmd += quote(*p);
+         }
+         break;
+      }
+      default:  cmd += *c; // %%
+      }
+   }
+
+   return cmd;
+}
+
+int launcher::run(const catalogue& games, Uint32 g, launch_stats& stats)
+{
+   if (_spawn) {
+      vector<string> args;
+      expand(games, g, args);
+
+      string cmd;
+      for (vector<string>::iterator a = args.begin(); a != args.end(); a++) {
+         if (!cmd.empty()) cmd += ' ';
+         cmd += quote(*a);
+      }
+
+      log << debug << "launcher: " << cmd << endl;
+      return spawn(args, stats);
+   }
+
+   string cmd(command(games, g));
+   log << debug << "launcher: " << cmd << endl;
+
+#ifdef HAVE_SPAWN_H
+   // what system() does, but without waiting blindly for the shell
+   vector<string> args;
+   args.push_back("/bin/sh");
+   args.push_back("-c");
+   args.push_back(cmd);
+   return spawn(args, stats);
+#else
+   stats.mark(launch_stats::spawn);
+   int status = system(cmd.c_str());
+   stats.mark(launch_stats::emulator);
+   return status;
+#endif
+}
+
+int launcher::spawn(const vector<string>& args, launch_stats& stats)
+{
+#ifdef HAVE_SPAWN_H
+   vector<char*> argv;
+   for (vector<string>::const_iterator i = args.begin(); i != args.end(); i++)
+      argv.push_back(const_cast<char*>(i->c_str()));
+   argv.push_back(NULL);
+
+   // signals blocked by the launcher's threads shouldn't stay blocked
+   // in the emulator
+   sigset_t none;
+   sigemptyset(&none);
+
+   // a process group of its own, so stopping it reaches whatever a shell
+   // or wrapper script started too
+   posix_spawnattr_t attr;
+   posix_spawnattr_init(&attr);
+   posix_spawnattr_setsigmask(&attr, &none);
+   posix_spawnattr_setpgroup(&attr, 0);
+   posix_spawnattr_setflags(&attr,
+         POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+   pid_t pid;
+   int err = posix_spawnp(&pid, argv[0], NULL, &attr, &argv[0], environ);
+   posix_spawnattr_destroy(&attr);
+   stats.mark(launch_stats::spawn);
+
+   if (err) {
+      log << error << "launcher: unable to start " << args[0] << ": "
+          << strerror(err) << endl;
+      return -1;
+   }
+
+   log << info << "launcher: started " << args[0] << ", pid " << pid << endl;
+
+   int status;
+   bool exited = supervise(pid, args[0], status);
+
+   stats.mark(launch_stats::emulator);
+
+   if (!exited)
+      return -1;
+
+   if (WIFEXITED(status)) {
+      if (WEXITSTATUS(status) != 0)
+         log << warn << "launcher: " << args[0] << " exited with "
+             << WEXITSTATUS(status) << endl;
+      return WEXITSTATUS(status);
+   }
+
+   if (WIFSIGNALED(status))
+      log << warn << "launcher: " << args[0] << " killed by signal "
+          << WTERMSIG(status) << endl;
+#endif
+
+   return -1;
+}
+
+bool launcher::supervise(int pid, const string& name, int& status)
+{
+#ifdef HAVE_SPAWN_H
+   input_watch input;
+   bool watchdog = _startup_timeout || _idle_timeout || _kill_key;
+
+   // without input the timeouts would always run out
+   if (watchdog && input.devices() == 0) {
+      log << warn << "launcher: no input devices readable, "
+          << "emulator won't be watched" << endl;
+      watchdog = false;
+   } else if (watchdog) {
+      log << debug << "launcher: watching " << input.devices()
+          << " input devices" << endl;
+   }
+
+   Uint32 started = SDL_GetTicks();
+   Uint32 last_input = started;
+   Uint32 held_since = 0; // time the kill key went down
+   Uint32 stopped_at = 0; // time the emulator was asked to exit
+   bool played = false;   // there has been input since starting
+   bool held = false;     // kill key is down
+   bool stopping = false; // emulator has been asked to exit
+   bool forced = false;   // emulator has been killed
+
+   for (;;) {
+      pid_t done = waitpid(pid, &status, WNOHANG);
+      if (done == pid)
+         return true;
+
+      if (done == -1 && errno != EINTR) {
+         log << error << "launcher: lost track of " << name << ": "
+             << strerror(errno) << endl;
+         return false;
+      }
+
+      bool was_held = held;
+      bool touched = input.wait(SUPERVISE_INTERVAL, _kill_key, held);
+      Uint32 now = SDL_GetTicks();
+
+      if (touched) {
+         last_input = now;
+         played = true;
+      }
+      if (held && !was_held)
+         held_since = now;
+
+      if (stopping) {
+         // still running after being asked to exit
+         if (!forced && now - stopped_at >= KILL_GRACE) {
+            log << warn << "launcher: " << name << " didn't exit, killing it"
+                << endl;
+            kill(-pid, SIGKILL);
+            forced = true;
+         }
+         continue;
+      }
+
+      if (!watchdog)
+         continue;
+
+      const char* reason = NULL;
+      if (held && now - held_since >= KILL_HOLD)
+         reason = "kill key held";
+      else if (!played && _startup_timeout && now - started >= _startup_timeout)
+         reason = "no input since it started";
+      else if (played && _idle_timeout && now - last_input >= _idle_timeout)
+         reason = "no input for too long";
+
+      if (reason) {
+         log << warn << "launcher: stopping " << name << ", " << reason << endl;
+         kill(-pid, SIGTERM);
+         stopping = true;
+         stopped_at = now;
+      }
+   }
+#else
+   return false;
+#endif
+}
+
+string launcher::quote(const string& arg)
+{
+   if (!arg.empty() && arg.find_first_of(" \t\n\"'\\$`;&|<>()*?[]#~") == string::npos)
+      return arg;
+
+   // inside double quotes only these characters are special to sh
+   string quoted("\"");
+   for (string::const_iterator c = arg.begin(); c != arg.end(); c++) {
+      if (*c == '"' || *c == '\\' || *c == '$' || *c == '`')
+         quoted += '\\';
+      quoted += *c;
+   }
+   quoted += '"';
+
+   return quoted;
+}
+
+void launcher::split(const string& cmd, vector<string>& args)
+{
+   string arg;
+   bool in_arg = false; // an argument has been started
+   char quote = 0;      // quote character of the quoted text we're in
+
+   for (string::const_iterator c = cmd.begin(); c != cmd.end(); c++) {
+      if (quote) {
+         if (*c == quote)
+            quote = 0;
+         else if (*c == '\\' && quote == '"' && c+1 != cmd.end())
+            arg += *++c;
+         else
+            arg += *c;
+      } else if (*c == '\'' || *c == '"') {
+         quote = *c;
+         in_arg = true; // even "" is an argument
+      } else if (*c == '\\' && c+1 != cmd.end()) {
+         arg += *++c;
+         in_arg = true;
+      } else if (*c == ' ' || *c == '\t' || *c == '\n') {
+         if (in_arg) {
+            args.push_back(arg);
+            arg.clear();
+            in_arg = false;
+         }
+      } else {
+         arg += *c;
+         in_arg = true;
+      }
+   }
+
+   if (in_arg)
+      args.push_back(arg);
+}
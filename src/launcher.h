@@ -0,0 +1,144 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef LAUNCHER_H_
+#define LAUNCHER_H_
+
+#include <SDL/SDL.h>
+#include <string>
+#include <vector>
+
+#include "error.h"
+#include "launchstats.h"
+
+using namespace std;
+
+namespace ll {
+
+class catalogue;
+
+/**
+ * Runs the emulator.  The mame option is parsed once into a template of
+ * arguments, and for each launch the specifiers in it are replaced with the
+ * game's values:
+ *
+ *   %r  rom name
+ *   %p  per-game params from games.db, split into arguments when they make
+ *       up a whole argument
+ *   %g  genre
+ *   %n  game name
+ *   %%  a percent sign
+ *
+ * Values are never split at white space, so a name with spaces stays one
+ * argument.
+ *
+ * In spawn mode the emulator is started directly with posix_spawnp, without
+ * a shell in between, while the launcher keeps SDL running and only gives up
+ * the screen.  In system mode the mame option is left as written for the
+ * shell, only the values are quoted into it, and it is run by /bin/sh
+ * while SDL is shut down completely.  That is slower to come back from but
+ * works with emulators that fight over the display.
+ *
+ * In both modes the emulator is watched over.  Holding the kill key, or
+ * leaving the controls alone for longer than the startup or idle timeout,
+ * asks it to exit and kills it if it doesn't.  It runs in a process group of
+ * its own and the whole group is signalled, so this reaches the emulator
+ * even when a shell started it.  The input devices are read directly (see
+ * input_watch) since the emulator has the display.
+ *
+ * Spawn mode needs spawn.h, without it system mode is always used, with
+ * system() and no watching over.  Spawn mode is also passed over for mame
+ * commands using the shell, such as redirections, variables or a ~ for the
+ * home directory.
+ */
+class launcher {
+private:
+   /* part of an argument, literal text or a specifier */
+   struct piece {
+      char spec;   // specifier letter, 0 for literal text
+      string text; // the literal text
+   };
+   typedef vector<piece> arg_t;
+
+   string _command;         // the mame option as written
+   vector<arg_t> _template; // the mame option, parsed into arguments
+   bool _spawn; // start the emulator directly, not through a shell
+   Uint32 _startup_timeout; // ms without input after starting, 0 for no limit
+   Uint32 _idle_timeout;    // ms without input once played, 0 for no limit
+   int _kill_key;           // linux key code that stops the emulator, 0 if none
+
+   /** Parses the mame option into the template */
+   void compile(const string& cmd) throw(bad_lemon&);
+
+   /** Fills the game's values, quoted, into the mame option for the shell */
+   string command(const catalogue& games, Uint32 g) const;
+
+   /**
+    * Starts the arguments with posix_spawnp, in a process group of their
+    * own, and waits for them to exit
+    */
+   int spawn(const vector<string>& args, launch_stats& stats);
+
+   /**
+    * Waits for the emulator to exit, stopping it if the kill key is held
+    * or nobody touches the controls for too long.
+    * @param status set to the wait status
+    * @return false if the emulator was lost track of
+    */
+   bool supervise(int pid, const string& name, int& status);
+
+   /** Quotes an argument for the shell, if it needs it */
+   static string quote(const string& arg);
+
+public:
+   /**
+    * Reads the launch mode option and parses the mame option, falling back
+    * to system mode if the mame option needs a shell
+    */
+   launcher() throw(bad_lemon&);
+
+   /**
+    * True if the launcher should only release the screen while the emulator
+    * runs, instead of shutting down SDL.
+    */
+   bool keeps_sdl() const
+   { return _spawn; }
+
+   /** Fills in the template for a game */
+   void expand(const catalogue& games, Uint32 g, vector<string>& args) const;
+
+   /**
+    * Runs the emulator for a game and waits for it to exit.
+    * @param stats marked when the emulator has started and when it exits,
+    * in system mode the shell starting counts as the emulator running
+    * @return zero if the emulator exited successfully
+    */
+   int run(const catalogue& games, Uint32 g, launch_stats& stats);
+
+   /**
+    * Splits a command line into arguments at white space.  Single and double
+    * quotes group white space into an argument, and outside single quotes a
+    * backslash takes the next character literally.
+    */
+   static void split(const string& cmd, vector<string>& args);
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "launchstats.h"
+#include "options.h"
+#include "log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+
+using namespace ll;
+using namespace std;
+
+static const char* phase_names[LAUNCH_PHASES] = {
+   "close_screen", "spawn", "emulator", "open_screen", "redraw", "record"
+};
+
+/** Quotes text for a CSV field when it needs it */
+static string csv_field(const string& text)
+{
+   if (text.find_first_of(",\"\n") == string::npos)
+      return text;
+
+   string quoted("\"");
+   for (string::const_iterator c = text.begin(); c != text.end(); c++) {
+      if (*c == '"') quoted += '"';
+      quoted += *c;
+   }
+   return quoted + '"';
+}
+
+/** Quotes text as a JSON string */
+static string json_string(const string& text)
+{
+   string quoted("\"");
+   for (string::const_iterator c = text.begin(); c != text.end(); c++) {
+      if (*c == '"' || *c == '\\')
+         quoted += '\\';
+
+      if ((unsigned char)*c < 0x20) {
+         char esc[8];
+         sprintf(esc, "\\u%04x", *c);
+         quoted += esc;
+      } else {
+         quoted += *c;
+      }
+   }
+   return quoted + '"';
+}
+
+launch_stats::launch_stats() :
+   _file(g_opts.get_string(KEY_LAUNCH_STATS)), _json(false), _start(0), _last(0)
+{
+   if (_file.empty())
+      return;
+
+   // relative names are in the conf dir, like games.db
+   if (_file[0] != '/')
+      g_opts.resolve(_file);
+
+   size_t dot = _file.rfind('.');
+   if (dot != string::npos) {
+      string ext(_file.substr(dot));
+      _json = ext == ".json" || ext == ".jsonl";
+   }
+}
+
+void launch_stats::start(const char* rom, const char* mode)
+{
+   _rom = rom;
+   _mode = mode;
+   _start = _last = now();
+   memset(_spans, 0, sizeof(_spans));
+}
+
+void launch_stats::mark(phase_t phase)
+{
+   Uint64 t = now();
+   _spans[phase] += t - _last;
+   _last = t;
+}
+
+void launch_stats::finish(int exit_code)
+{
+   log << info << "launch_stats: " << _rom << " exit " << exit_code;
+   for (int p = 0; p < LAUNCH_PHASES; p++)
+      log << ", " << phase_names[p] << ' ' << _spans[p] / 1000 << "ms";
+   log << ", total " << (_last - _start) / 1000 << "ms" << endl;
+
+   if (!_file.empty())
+      write(exit_code);
+}
+
+void launch_stats::write(int exit_code) const
+{
+   FILE* f = fopen(_file.c_str(), "a");
+   if (!f) {
+      log << warn << "launch_stats: unable to open " << _file << endl;
+      return;
+   }
+
+   if (_json) {
+      fprintf(f, "{\"time\":%ld,\"version\":%s,\"rom\":%s,\"mode\":%s,\"exit\":%d",
+            (long)time(NULL), json_string(PACKAGE_VERSION).c_str(),
+            json_string(_rom).c_str(), json_string(_mode).c_str(), exit_code);
+      for (int p = 0; p < LAUNCH_PHASES; p++)
+         fprintf(f, ",\"%s_us\":%llu", phase_names[p],
+               (unsigned long long)_spans[p]);
+      fprintf(f, "}\n");
+   } else {
+      // a new file starts with the column names
+      fseek(f, 0, SEEK_END);
+      if (ftell(f) == 0) {
+         fprintf(f, "time,version,rom,mode,exit");
+         for (int p = 0; p < LAUNCH_PHASES; p++)
+            fprintf(f, ",%s_us", phase_names[p]);
+         fprintf(f, "\n");
+      }
+
+      fprintf(f, "%ld,%s,%s,%s,%d", (long)time(NULL),
+            csv_field(PACKAGE_VERSION).c_str(), csv_field(_rom).c_str(),
+            csv_field(_mode).c_str(), exit_code);
+      for (int p = 0; p < LAUNCH_PHASES; p++)
+         fprintf(f, ",%llu", (unsigned long long)_spans[p]);
+      fprintf(f, "\n");
+   }
+
+   if (fclose(f) != 0)
+      log << warn << "launch_stats: unable to write " << _file << endl;
+}
+
+Uint64 launch_stats::now()
+{
+#ifdef HAVE_CLOCK_GETTIME
+   struct timespec ts;
+   if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+      return (Uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+
+   return (Uint64)SDL_GetTicks() * 1000;
+}
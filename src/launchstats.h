@@ -0,0 +1,84 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef LAUNCHSTATS_H_
+#define LAUNCHSTATS_H_
+
+#include <SDL/SDL.h>
+#include <string>
+
+/* number of phases timed */
+#define LAUNCH_PHASES 6
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Times the phases of launching a game on a monotonic clock.  Each mark
+ * ends the span of a phase, which started at the previous mark (or at
+ * start).  When the launch is finished the spans are logged and, when the
+ * launch_stats option names a file, appended to it as one line.  Files
+ * ending in .json or .jsonl get JSON lines, anything else gets CSV with a
+ * header line when the file is new.
+ */
+class launch_stats {
+public:
+   typedef enum {
+      close_screen, // releasing or destroying the screen
+      spawn,        // starting the emulator
+      emulator,     // the emulator running, until it exits
+      open_screen,  // restoring or setting up the screen again
+      redraw,       // the first render after coming back
+      record        // counting the play and updating views
+   } phase_t;
+
+private:
+   string _file;   // stats file, empty for none
+   bool _json;     // write JSON lines instead of CSV
+
+   string _rom;    // rom being launched
+   string _mode;   // launch mode
+   Uint64 _start;  // time of start, in microseconds
+   Uint64 _last;   // time of the last mark
+   Uint64 _spans[LAUNCH_PHASES]; // microseconds spent in each phase
+
+   /** Appends the launch to the stats file */
+   void write(int exit_code) const;
+
+public:
+   /** Reads the launch stats option */
+   launch_stats();
+
+   /** Starts timing the launch of a rom */
+   void start(const char* rom, const char* mode);
+
+   /** Ends the span of a phase, at the current time */
+   void mark(phase_t phase);
+
+   /** Logs the spans and writes them to the stats file */
+   void finish(int exit_code);
+
+   /** Returns the time in microseconds on a clock that never goes back */
+   static Uint64 now();
+};
+
+} // end namespace
+
+#endif
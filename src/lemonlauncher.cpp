@@ -19,17 +19,85 @@
  */
 #include <config.h>
 #include <string>
+#include <vector>
 #include <stdlib.h>
+#include <string.h>
+#include <sqlite3.h>
 
 #include "error.h"
 #include "options.h"
 #include "log.h"
 #include "lemonmenu.h"
 #include "lemonui.h"
+#include "snaploader.h"
 
 using namespace ll;
 using namespace std;
 
+/**
+ * Loads the snapshot of every game in games.db through the snapshot loader
+ * so the thumbnail store is complete before the menu is first shown.
+ */
+static void build_thumbs(lemonui* ui)
+{
+   if (!g_opts.get_bool(KEY_THUMBNAIL_CACHE)) {
+      log << warn << "build_thumbs: thumbnail_cache option is disabled" << endl;
+      return;
+   }
+   
+   string db_file("games.db");
+   g_opts.resolve(db_file);
+   
+   sqlite3* db;
+   if (sqlite3_open(db_file.c_str(), &db)) {
+      log << error << "build_thumbs: " << sqlite3_errmsg(db) << endl;
+      sqlite3_close(db);
+      return;
+   }
+   
+   vector<string> roms;
+   sqlite3_stmt* stmt;
+   
+   if (sqlite3_prepare(db, "SELECT filename FROM games", -1, &stmt, NULL) == SQLITE_OK) {
+      while (sqlite3_step(stmt) == SQLITE_ROW)
+         roms.push_back((const char*)sqlite3_column_text(stmt, 0));
+      sqlite3_finalize(stmt);
+   }
+   
+   sqlite3_close(db);
+   
+   snap_loader loader(ui, g_opts.get_int(KEY_SNAPSHOT_THREADS));
+   loader.request(roms);
+   
+   log << info << "build_thumbs: " << roms.size() << " games, "
+       << loader.stored() << " snapshots already stored" << endl;
+   
+   size_t done = 0, missing = 0;
+   SDL_Event event;
+   
+   while (done < roms.size() && SDL_WaitEvent(&event)) {
+      if (event.type == SDL_QUIT)
+         break;
+      
+      string rom;
+      SDL_Surface* surface;
+      
+      while (loader.take(rom, surface)) {
+         if (surface)
+            SDL_FreeSurface(surface);
+         else
+            missing++;
+         
+         if (++done % 100 == 0)
+            log << info << "build_thumbs: " << done << " of " << roms.size()
+                << " loaded" << endl;
+      }
+   }
+   
+   log << info << "build_thumbs: " << loader.stored() << " snapshots stored, "
+       << missing << " games without a snapshot" << endl;
+}
+
 int main(int argc, char** argv)
 {
 #ifdef HAVE_CONF_DIR
@@ -53,8 +121,12 @@ int main(int argc, char** argv)
       ui = new lemonui(g_opts.get_string(KEY_SKIN_FILE));
       ui->setup_screen();
       
-      menu = new lemon_menu(ui);
-      menu->main_loop();
+      if (argc > 1 && strcmp(argv[1], "--build-thumbs") == 0) {
+         build_thumbs(ui);
+      } else {
+         menu = new lemon_menu(ui);
+         menu->main_loop();
+      }
    } catch (bad_lemon& e) {
       // error was already logged in bad_lemon constructor
       // TODO be a good boy damn it and handle your exceptions!
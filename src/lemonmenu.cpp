@@ -18,19 +18,23 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include "lemonmenu.h"
-#include "game.h"
 #include "options.h"
 #include "error.h"
 
 #include <cstring>
-#include <sqlite3.h>
+#include <cctype>
 #include <sstream>
 #include <algorithm>
-#include <typeinfo>
 #include <SDL/SDL_rotozoom.h>
 
 #define UPDATE_SNAP_EVENT 1
 
+/* entered sub menus that keep their games listed, older ones are unloaded */
+#define MAX_LOADED_MENUS 4
+
+/* characters a search query is spelled from with pgup and pgdown */
+static const char spell_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789 ";
+
 using namespace ll;
 using namespace std;
 
@@ -39,44 +43,60 @@ using namespace std;
  */
 static Uint32 snap_timer_callback(Uint32 interval, void *param);
 
-/**
- * Function executed for each record returned from games list queries
- */
-int sql_callback(void *obj, int argc, char **argv, char **colname);
-
 /**
  * Asyncronous function for launching a game
  */
 int launch_game(void* data);
 
-/**
- * Compares the text property of two item pointers and returns true if the left
- * is less than the right.
- */
-bool cmp_item(item* left, item* right)
-{ return strcmp(left->text(), right->text()) < 0; }
-
 lemon_menu::lemon_menu(lemonui* ui) :
-   _db(NULL), _top(NULL), _current(NULL), _show_hidden(false),
-   _snap_timer(0), _snap_delay(g_opts.get_int(KEY_SNAPSHOT_DELAY))
+   _db(NULL), _catalogue(NULL), _loader(NULL), _snaps(NULL),
+   _launcher(NULL), _warmer(NULL), _stats(NULL),
+   _top(NULL), _current(NULL), _show_hidden(false),
+   _search(NULL), _results(NULL), _search_from(NULL),
+   _snap_timer(0), _snap_delay(g_opts.get_int(KEY_SNAPSHOT_DELAY)),
+   _snap_prefetch(g_opts.get_int(KEY_SNAPSHOT_PREFETCH)), _snap_due(false)
 {
-   // locate games.db file in confdir
-   string db_file("games.db");
-   g_opts.resolve(db_file);
-   
-   if (sqlite3_open(db_file.c_str(), &_db))
-      throw bad_lemon(sqlite3_errmsg(_db));
+   _db = new game_db();
    
    _layout = ui;
+   _catalogue = new catalogue(_db->handle(), _db->file());
+   if (_catalogue->modified())
+      _catalogue->save_cache(); // read from games.db, cache it for next time
+   _snaps = new snap_cache(g_opts.get_int(KEY_SNAPSHOT_CACHE_SIZE) * 1024);
+   _loader = new snap_loader(ui, g_opts.get_int(KEY_SNAPSHOT_THREADS));
+   _launcher = new launcher();
+   _warmer = new rom_warmer();
+   _stats = new launch_stats();
+   
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      _tops[v] = NULL;
+      _stale[v] = false;
+   }
    change_view(favorite);
 }
 
 lemon_menu::~lemon_menu()
 {
-   delete _top; // delete top menu will propigate to children
+   // snapshots may point into the loader's thumbnail store, free them first
+   _layout->snap(NULL);
+   delete _snaps;
+   delete _loader;
+   delete _launcher;
+   delete _warmer;
+   delete _stats;
+   delete _results;
+   delete _search;
+   // delete top menu will propigate to sub menus
+   for (int v = 0; v < VIEW_COUNT; v++)
+      delete _tops[v];
+   // games.db now has the plays and flag changes, cache it as it is unless
+   // another program changed it since the last poll
+   bool current = _db->finish();
+   delete _db;
    
-   if (_db)
-      sqlite3_close(_db);
+   if (current && _catalogue->modified())
+      _catalogue->save_cache();
+   delete _catalogue;
 }
 
 void lemon_menu::render()
@@ -100,6 +120,10 @@ void lemon_menu::main_loop()
    const int back_key = g_opts.get_int(KEY_KEYCODE_BACK);
    const int alphamod = g_opts.get_int(KEY_KEYCODE_ALPHAMOD);
    const int viewmod = g_opts.get_int(KEY_KEYCODE_VIEWMOD);
+   const int search_key = g_opts.get_int(KEY_KEYCODE_SEARCH);
+   const int favourite_key = g_opts.get_int(KEY_KEYCODE_FAVOURITE);
+   const int hide_key = g_opts.get_int(KEY_KEYCODE_HIDE);
+   const int show_hidden_key = g_opts.get_int(KEY_KEYCODE_SHOW_HIDDEN);
 
    _running = true;
    while (_running) {
@@ -115,17 +139,36 @@ void lemon_menu::main_loop()
 
          break;
       case SDL_KEYUP:
-         if (key == exit_key) {
+         if (_search_from && key == exit_key) {
+            end_search();
+         } else if (_search_from && key == back_key) {
+            search_erase();
+         } else if (key == exit_key) {
             _running = false;
          } else if (key == select_key) {
             handle_activate();
          } else if (key == back_key) {
             handle_up_menu();
+         } else if (key == favourite_key && !_search_from) {
+            handle_favourite();
+         } else if (key == hide_key && !_search_from) {
+            handle_hide();
+         } else if (key == show_hidden_key && !_search_from) {
+            handle_show_hidden();
          }
 
          break;
       case SDL_KEYDOWN:
-         if (key == up_key) {
+         if (key == search_key) {
+            handle_search();
+         } else if (_search_from && (key == pgup_key || key == pgdown_key)) {
+            search_cycle(key == pgdown_key? 1 : -1);
+         } else if (_search_from && key == SDLK_BACKSPACE && key != back_key) {
+            search_erase();
+         } else if (_search_from && key != select_key && key != back_key &&
+               event.key.keysym.unicode >= ' ' && event.key.keysym.unicode < 127) {
+            search_type((char)event.key.keysym.unicode);
+         } else if (key == up_key) {
             handle_up();
          } else if (key == down_key) {
             handle_down();
@@ -149,6 +192,12 @@ void lemon_menu::main_loop()
       case SDL_USEREVENT:
          if (event.user.code == UPDATE_SNAP_EVENT)
             update_snap();
+         else if (event.user.code == SNAP_LOADED_EVENT)
+            collect_snaps();
+         else if (event.user.code == SNAP_CHANGED_EVENT)
+            snaps_changed();
+         else if (event.user.code == CATALOGUE_CHANGED_EVENT)
+            catalogue_changed();
 
          break;
       }
@@ -211,7 +260,7 @@ void lemon_menu::handle_alphadown()
 
 void lemon_menu::handle_viewup()
 {
-   if (_view != genre) {
+   if (_view != VIEW_COUNT-1) {
       change_view((view_t)(_view+1));
       reset_snap_timer();
       render();
@@ -232,27 +281,19 @@ void lemon_menu::handle_activate()
    // ignore when this isn't any children
    if (!_current->has_children()) return;
 
-   item* item = _current->selected();
-   if (typeid(menu) == typeid(*item)) {
+   if (_current->has_menus()) {
       handle_down_menu();
-   } else if (typeid(game) == typeid(*item)) {
+   } else {
       handle_run();
    }
 }
 
 void lemon_menu::handle_run()
 {
-   game* g = (game*)_current->selected();
-   log << info << "handle_run: launching game " << g->text() << endl;
+   Uint32 g = _current->selected_game();
+   string rom(_catalogue->rom(g)); // the catalogue may be reloaded meanwhile
+   log << info << "handle_run: launching game " << _catalogue->name(g) << endl;
    
-   string cmd(g_opts.get_string(KEY_MAME_PATH));
-   size_t pos = cmd.find("%r");
-   if (pos == string::npos)
-      throw bad_lemon("mame path missing %r specifier");
-
-   cmd.replace(pos, 2, g->rom());
-   ll::log << debug << "handle_run: " << cmd << endl;
-
    // This bit of code here has been a big pain.  On linux in full screen (X11)
    // lemon launcher has to be minimized before launching mame or else things
    // tend to lock up.  On windows lemon launcher is automagically minimized
@@ -262,53 +303,172 @@ void lemon_menu::handle_run()
    // That said, I think I have it sorted.  Simply destroying lemon launchers
    // screen and then re-creating it after mame exits seems to get rid of the
    // irregularities.  Even on Windows!
-
-   // destroy buffers and screen
-   _layout->destroy_screen();
+   //
+   // Giving up just the video subsystem does the same for the display, and
+   // keeps everything else loaded so coming back is quick.  The full
+   // teardown stays as the system launch mode.
+
+   _stats->start(rom.c_str(), _launcher->keeps_sdl()? "spawn" : "system");
+
+   // the emulator reads the roms itself, don't compete with it for the disk
+   _warmer->cancel();
+
+   int exit_code;
+   if (_launcher->keeps_sdl()) {
+      _layout->release_screen();
+      _stats->mark(launch_stats::close_screen);
+      exit_code = _launcher->run(*_catalogue, g, *_stats);
+      _layout->restore_screen();
+   } else {
+      // destroy buffers and screen
+      _layout->destroy_screen();
+      _stats->mark(launch_stats::close_screen);
+      
+      // launch mame and hope for the best
+      exit_code = _launcher->run(*_catalogue, g, *_stats);
+      
+      // create screen
+      _layout->setup_screen();
+   }
    
-   // launch mame and hope for the best
-   int exit_code = system(cmd.c_str());
+   // restarting video resets keyboard translation
+   if (_search_from)
+      SDL_EnableUNICODE(1);
    
-   // create screen and render
-   _layout->setup_screen();
+   _stats->mark(launch_stats::open_screen);
    render();
+   _stats->mark(launch_stats::redraw);
+   
+   // events can't be queued without the video subsystem, pick up whatever
+   // the threads finished while the game was running.  A catalogue loaded
+   // meanwhile doesn't have this play yet, so it's swapped in first.
+   collect_snaps();
+   snaps_changed();
+   bool listed = true; // the game is in the catalogue, it may have gone
+   if (catalogue_changed())
+      listed = _catalogue->lookup(rom, g);
    
    // only increment the games play counter if emulator returned success
-   if (exit_code == 0) {
+   if (exit_code == 0)
+      _db->played(rom.c_str()); // written in the background, with last_played
+   
+   if (exit_code == 0 && listed) {
+      _catalogue->played(g);
+      _stale[most_played] = true; // rebuilt when next shown
       
-      // locate games.db file in confdir
-      string db_file("games.db");
-      g_opts.resolve(db_file);
+      // move the game to the front of recently played, without a rebuild
+      menu* recent = _tops[recently_played];
+      if (recent && (_show_hidden || !_catalogue->hidden(g))) {
+         recent->remove_game(g);
+         recent->insert_game(0, g);
+         
+         // the launched game stays selected
+         if (recent == _current) {
+            recent->select(0);
+            reset_snap_timer();
+            render();
+         }
+      }
+   }
+   
+   _stats->mark(launch_stats::record);
+   _stats->finish(exit_code);
+}
+
+void lemon_menu::handle_favourite()
+{
+   if (!_current->has_children() || _current->has_menus()) return;
+   
+   Uint32 g = _current->selected_game();
+   bool fav = !_catalogue->favourite(g);
+   
+   _catalogue->set_favourite(g, fav);
+   _db->set_favourite(_catalogue->rom(g), fav); // written in the background
+   
+   // the favorites view is updated in place rather than built again
+   menu* favourites = _tops[favorite];
+   if (favourites && (_show_hidden || !_catalogue->hidden(g))) {
+      if (fav)
+         favourites->insert_game(g);
+      else
+         favourites->remove_game(g);
+   }
+   
+   log << debug << "handle_favourite: " << _catalogue->name(g)
+       << (fav? " added" : " removed") << endl;
+   
+   if (_current == favourites)
+      reset_snap_timer();
+   render();
+}
+
+void lemon_menu::handle_hide()
+{
+   if (!_current->has_children() || _current->has_menus()) return;
+   
+   Uint32 g = _current->selected_game();
+   bool hide = !_catalogue->hide(g);
    
-      // create query to update number of times game has been played
-      string query("UPDATE games SET count = count+1 WHERE filename = ");
-      query.append("'").append(g->rom()).append("'");
+   _catalogue->set_hide(g, hide);
+   _db->set_hide(_catalogue->rom(g), hide); // written in the background
    
-      sqlite3* db = NULL;
-      char* error_msg = NULL;
+   log << debug << "handle_hide: " << _catalogue->name(g)
+       << (hide? " hidden" : " shown") << endl;
    
-      try {
-         if (sqlite3_open(db_file.c_str(), &db))
-            throw bad_lemon(sqlite3_errmsg(db));
+   // hidden games are only listed when showing hidden games
+   if (_show_hidden || !hide)
+      return;
+   
+   // take the game out of the menus built so far
+   for (int v = 0; v < VIEW_COUNT; v++) {
+      menu* top = _tops[v];
+      if (!top) continue;
+      
+      if (!top->has_menus())
+         top->remove_game(g);
+      
+      for (int i = 0; top->has_menus() && i < top->size(); i++)
+         top->sub_menu(i)->remove_game(g);
+      
+      // a sub menu left without games isn't listed either
+      Uint32 first, visible;
+      if (!top->has_menus() ||
+            !_catalogue->find_group((view_t)v, g, first, visible) || visible > 0)
+         continue;
+      
+      for (int i = 0; i < top->size(); i++) {
+         menu* m = top->sub_menu(i);
+         if (m->first() != first) continue;
          
-         // execute query and throw exception on error
-         if (sqlite3_exec(db, query.c_str(), NULL, NULL, &error_msg)
-               != SQLITE_OK)
-            throw bad_lemon(error_msg);
-      } catch (...) {
-         sqlite3_free(error_msg);
-         throw;
+         _loaded.erase(remove(_loaded.begin(), _loaded.end(), m), _loaded.end());
+         if (_current == m)
+            _current = top;
+         top->remove_menu(m);
+         break;
       }
-      
-      if (db)
-         sqlite3_close(db);
    }
+   
+   reset_snap_timer();
+   render();
+}
+
+void lemon_menu::handle_show_hidden()
+{
+   _show_hidden = !_show_hidden;
+   
+   log << debug << "handle_show_hidden: hidden games "
+       << (_show_hidden? "shown" : "not shown") << endl;
+   
+   rebuild_views(NULL);
+   
+   reset_snap_timer();
+   render();
 }
 
 void lemon_menu::handle_up_menu()
 {
    if (_current != _top) {
-      _current = (menu*)_current->parent();
+      _current = _current->parent();
       reset_snap_timer();
       render();
    }
@@ -316,122 +476,352 @@ void lemon_menu::handle_up_menu()
 
 void lemon_menu::handle_down_menu()
 {
-   _current = (menu*)_current->selected();
+   menu* m = _current->selected_menu();
+   m->load();
+   
+   // free the games of the sub menus entered longest ago
+   _loaded.erase(remove(_loaded.begin(), _loaded.end(), m), _loaded.end());
+   _loaded.push_back(m);
+   while (_loaded.size() > MAX_LOADED_MENUS) {
+      _loaded.front()->unload();
+      _loaded.erase(_loaded.begin());
+   }
+   
+   _current = m;
    reset_snap_timer();
    render();
 }
 
-void lemon_menu::update_snap()
+void lemon_menu::handle_search()
 {
-   if (_current->has_children()) {
-      item* item = _current->selected();
-      _layout->snap(item->snapshot());
-      render();
+   if (_search_from) {
+      // already searching, start spelling another character
+      search_type(spell_chars[0]);
+      return;
    }
+   
+   if (!_search)
+      _search = new search_index(*_catalogue);
+   if (!_results)
+      _results = new menu("", _catalogue);
+   
+   _search_from = _current;
+   _search_games.clear();
+   _search_from->collect_games(_search_games);
+   _query.clear();
+   _results->clear();
+   
+   // keyboard characters arrive as unicode
+   SDL_EnableUNICODE(1);
+   
+   update_search();
 }
 
-void lemon_menu::reset_snap_timer()
+void lemon_menu::update_search()
 {
-   if (_snap_timer)
-      SDL_RemoveTimer(_snap_timer);
-
-   // schedule timer to run in 500 milliseconds
-   _snap_timer = SDL_AddTimer(_snap_delay, snap_timer_callback, NULL);
+   Uint32 start = SDL_GetTicks();
+   
+   // keep the selected game selected while it still matches
+   bool had_selection = _results->has_children();
+   Uint32 selected = had_selection? _results->selected_game() : 0;
+   
+   _results->clear();
+   _results->rename("Search: " + _query);
+   
+   if (_query.empty()) {
+      _results->reserve(_search_games.size());
+      for (vector<Uint32>::iterator i = _search_games.begin(); i != _search_games.end(); i++)
+         _results->add_game(*i);
+   } else {
+      _search->find(_query, _search_marks);
+      for (vector<Uint32>::iterator i = _search_games.begin(); i != _search_games.end(); i++)
+         if (_search_marks[*i]) _results->add_game(*i);
+   }
+   
+   if (had_selection)
+      _results->select_game(selected);
+   
+   log << debug << "update_search: '" << _query << "' matched " << _results->size()
+       << " games in " << SDL_GetTicks() - start << "ms" << endl;
+   
+   _current = _results;
+   reset_snap_timer();
+   render();
 }
 
-void lemon_menu::change_view(view_t view)
+void lemon_menu::end_search()
 {
-   _view = view;
+   // select the game that was selected in the results
+   if (_results->has_children())
+      _search_from->select_game(_results->selected_game());
    
-   // recurisvely free top menu / children
-   if (_top != NULL)
-      delete _top;
+   _current = _search_from;
+   _search_from = NULL;
    
-   // create new top menu
-   _current = _top = new menu(view_names[_view]);
+   SDL_EnableUNICODE(0);
    
-   string query("SELECT filename, name, params, genre FROM games");
-   string where, order;
+   reset_snap_timer();
+   render();
+}
+
+void lemon_menu::search_type(char ch)
+{
+   _query += ch;
+   update_search();
+}
+
+void lemon_menu::search_cycle(int step)
+{
+   const int count = sizeof(spell_chars) - 1;
+   
+   if (_query.empty()) {
+      _query += spell_chars[step > 0? 0 : count - 1];
+   } else {
+      // unknown characters (typed from the keyboard) cycle from the start
+      const char* pos = strchr(spell_chars, tolower(_query[_query.size()-1]));
+      int index = pos? pos - spell_chars : 0;
+      _query[_query.size()-1] = spell_chars[(index + step + count) % count];
+   }
+   
+   update_search();
+}
+
+void lemon_menu::search_erase()
+{
+   if (_query.empty()) {
+      end_search();
+   } else {
+      _query.erase(_query.size()-1);
+      update_search();
+   }
+}
+
+void lemon_menu::update_snap()
+{
+   _snap_due = true;
+   show_snap();
    
-   switch (_view) {
-   case favorite:
-      order.append("name");
-      where.append("favourite = 1");
-      break;
+   // the game dwelt on is likely to be launched, get its roms off the disk
+   if (_warmer->enabled() && _current->has_children() && !_current->has_menus()) {
+      Uint32 g = _current->selected_game();
+      vector<string> roms(1, _catalogue->rom(g));
       
-   case most_played:
-      order.append("count,name");
-      where.append("count > 0");
-      break;
+      // clones need their parent's roms too
+      if (*_catalogue->clone_of(g))
+         roms.push_back(_catalogue->clone_of(g));
       
-   case genre:
-      order.append("genre,name");
-      break;
+      _warmer->request(roms);
    }
+}
+
+void lemon_menu::show_snap()
+{
+   if (!_snap_due || !_current->has_children())
+      return;
    
-   if (!_show_hidden) {
-      if (where.length() != 0) where.append(" AND ");
-      where.append("hide = 0 AND missing = 0");
+   SDL_Surface* snap = NULL;
+   
+   // wait for a loaded event when the snapshot is still being decoded
+   if (!_current->has_menus()) {
+      const char* rom = _catalogue->rom(_current->selected_game());
+      
+      if (!_snaps->get(rom, snap)) {
+         // neighbours loaded after it can push it out of the cache before
+         // it's shown, then no loaded event is coming
+         if (!_loader->pending(rom))
+            prefetch_snaps();
+         return;
+      }
    }
    
-   // assemble query
-   query.append(" WHERE ").append(where);
-   query.append(" ORDER BY ").append(order);
+   _snap_due = false;
+   _layout->snap(snap);
+   render();
+   
+   _snaps->log_stats();
+}
+
+void lemon_menu::collect_snaps()
+{
+   string rom;
+   SDL_Surface* snap;
    
-   log << debug << "change_view: " << query.c_str() << endl;
+   // move finished snapshots into the cache
+   while (_loader->take(rom, snap))
+      _snaps->put(rom, snap);
    
-   char* error_msg = NULL;
+   // the selected snapshot stays ahead of the neighbours loaded after it
+   if (_current->has_children() && !_current->has_menus())
+      _snaps->touch(_catalogue->rom(_current->selected_game()));
+   
+   show_snap();
+}
 
-   try {
-      if (sqlite3_exec(_db, query.c_str(), &sql_callback,
-            (void*)this, &error_msg) != SQLITE_OK)
-         throw bad_lemon(error_msg);
-   } catch (...) {
-      sqlite3_free(error_msg);
-      throw;
+void lemon_menu::snaps_changed()
+{
+   string rom;
+   bool selected = false;
+   const char* current = _current->has_children() && !_current->has_menus()?
+      _catalogue->rom(_current->selected_game()) : NULL;
+   
+   // forget changed snapshots so they are loaded again
+   while (_loader->take_changed(rom)) {
+      _snaps->remove(rom);
+      if (current && rom == current)
+         selected = true;
+   }
+   
+   if (selected) {
+      prefetch_snaps();
+      update_snap();
    }
 }
 
-int sql_callback(void* obj, int argc, char **argv, char **colname)
+bool lemon_menu::catalogue_changed()
 {
-   lemon_menu* lm = (lemon_menu*)obj;
-   menu* top = lm->top();
+   catalogue* fresh = _db->take_catalogue();
+   if (!fresh) return false;
    
-   game* g = new game(argv[0], argv[1], argv[2]);
+   // the search index and results point into the old catalogue
+   if (_search_from)
+      end_search();
+   delete _search;
+   delete _results;
+   _search = NULL;
+   _results = NULL;
    
-   switch (lm->view()) {
-   case favorite:
-   case most_played:
-      top->add_child(g);
-      
-      break;
-      
-   case genre:
-      menu* m = NULL;
-      if (!top->has_children()) {
-         // if top menu doesn't have a menu yet, create one for the genre
-         m = new menu(argv[3]);
-         top->add_child(m);
-      } else {
-         // get last child of the top level menu
-         vector<item*>::iterator i = top->last();
-         --i; // move iterator to the last item in list
-         
-         m = (menu*)*i;
+   rebuild_views(fresh);
+   
+   // saved here rather than on the loading thread, it's still as loaded
+   if (_catalogue->modified())
+      _catalogue->save_cache();
+   
+   // loaded without logging on the game_db thread, logged here instead
+   log << info << "catalogue_changed: reloaded " << _catalogue->size()
+       << " games (" << _catalogue->bytes() / 1024 << "k)" << endl;
+   
+   reset_snap_timer();
+   render();
+   
+   return true;
+}
 
-         // create new child menu of the genre strings don't match
-         if (strcmp(m->text(), argv[3]) != 0) {
-            m = new menu(argv[3]);
-            top->add_child(m);
+void lemon_menu::rebuild_views(catalogue* fresh)
+{
+   if (_search_from)
+      end_search();
+   
+   // remember where we were by name, indices change with the catalogue
+   string sub_menu(_current != _top? _current->text() : "");
+   string rom(_current->has_children() && !_current->has_menus()?
+      _catalogue->rom(_current->selected_game()) : "");
+   
+   for (int v = 0; v < VIEW_COUNT; v++)
+      if (_tops[v]) drop_view((view_t)v);
+   
+   if (fresh) {
+      delete _catalogue;
+      _catalogue = fresh;
+   }
+   
+   change_view(_view);
+   
+   if (!sub_menu.empty()) {
+      for (int i = 0; _top->has_menus() && i < _top->size(); i++) {
+         if (sub_menu == _top->sub_menu(i)->text()) {
+            _top->select(i);
+            handle_down_menu();
+            break;
          }
       }
+   }
+   
+   if (!rom.empty() && !_current->has_menus()) {
+      for (int i = 0; i < _current->size(); i++) {
+         if (rom == _catalogue->rom(_current->game(i))) {
+            _current->select(i);
+            break;
+         }
+      }
+   }
+}
+
+void lemon_menu::prefetch_snaps()
+{
+   vector<string> roms;
+   
+   if (_current->has_children() && !_current->has_menus()) {
+      int sel = _current->selected();
       
-      m->add_child(g);
+      // selected game first, then its neighbours working outwards
+      for (int i = 0; i <= _snap_prefetch; i++) {
+         if (sel >= i) {
+            const char* rom = _catalogue->rom(_current->game(sel - i));
+            if (!_snaps->contains(rom)) roms.push_back(rom);
+         }
+         
+         if (i > 0 && _current->size() - sel > i) {
+            const char* rom = _catalogue->rom(_current->game(sel + i));
+            if (!_snaps->contains(rom)) roms.push_back(rom);
+         }
+      }
+   }
+   
+   _loader->request(roms);
+}
+
+void lemon_menu::reset_snap_timer()
+{
+   if (_snap_timer)
+      SDL_RemoveTimer(_snap_timer);
+
+   // decoding starts right away, the timer only delays showing the result
+   _snap_due = false;
+   prefetch_snaps();
+   
+   // the selection moved, stop warming the roms of the last one
+   _warmer->cancel();
+
+   // schedule timer to run in 500 milliseconds
+   _snap_timer = SDL_AddTimer(_snap_delay, snap_timer_callback, NULL);
+}
+
+void lemon_menu::change_view(view_t view)
+{
+   // the menu being searched may be about to be deleted
+   if (_search_from)
+      end_search();
+   
+   _view = view;
+   
+   // views are built when first shown and kept until their games change
+   if (_tops[_view] && _stale[_view])
+      drop_view(_view);
+   
+   if (!_tops[_view]) {
+      _tops[_view] = _catalogue->build(_view, _show_hidden);
+      _stale[_view] = false;
+   }
+   
+   _current = _top = _tops[_view];
+   
+   log << debug << "change_view: " << view_names[_view] << endl;
+}
 
-      break;
+void lemon_menu::drop_view(view_t view)
+{
+   // forget loaded sub menus of the view
+   vector<menu*>::iterator i = _loaded.begin();
+   while (i != _loaded.end()) {
+      if ((*i)->parent() == _tops[view])
+         i = _loaded.erase(i);
+      else
+         i++;
    }
    
-   return 0;
+   // recurisvely free top menu / sub menus, games belong to the catalogue
+   delete _tops[view];
+   _tops[view] = NULL;
 }
 
 Uint32 snap_timer_callback(Uint32 interval, void *param)
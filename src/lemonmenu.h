@@ -22,24 +22,32 @@
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
-#include <sqlite3.h>
 
 #include "lemonui.h"
+#include "snaploader.h"
+#include "snapcache.h"
 #include "menu.h"
+#include "catalogue.h"
+#include "searchindex.h"
+#include "gamedb.h"
+#include "launcher.h"
+#include "romwarmer.h"
+#include "launchstats.h"
 #include "options.h"
 #include "log.h"
 
 namespace ll {
 
-typedef enum { favorite, most_played, genre } view_t;
-static const char* view_names[] = {
-      "Favorites", "Most Played", "Genres"
-};
-
 class lemon_menu {
 private:
-   sqlite3* _db;
+   game_db* _db;
+   catalogue* _catalogue; // every game, menus only point into it
    lemonui* _layout;
+   snap_loader* _loader;
+   snap_cache* _snaps; // outlives the menu tree, so survives change_view
+   launcher* _launcher;
+   rom_warmer* _warmer; // reads ahead the roms of the game dwelt on
+   launch_stats* _stats; // times the phases of each launch
 
    bool _running;
    bool _show_hidden;
@@ -47,15 +55,44 @@ private:
    menu* _top;
    menu* _current;
    view_t _view;
+   menu* _tops[VIEW_COUNT]; // views built so far, NULL until first shown
+   bool _stale[VIEW_COUNT]; // view lists games that have changed
+   vector<menu*> _loaded; // entered sub menus, least recently entered first
+   
+   search_index* _search; // built the first time a search starts
+   menu* _results;        // the menu searched, narrowed to matching games
+   menu* _search_from;    // the menu searched, NULL when not searching
+   vector<Uint32> _search_games; // games of the menu searched, in order
+   vector<Uint8> _search_marks;  // matches of the query, by game
+   string _query;
    
    const int _snap_delay;
+   const int _snap_prefetch;
    SDL_TimerID  _snap_timer;
+   bool _snap_due; // snap timer fired, show snapshot as soon as it's loaded
 
    void render();
 
    void reset_snap_timer();
    void update_snap();
+   void show_snap();
+   void collect_snaps();
+   void snaps_changed();
+   bool catalogue_changed();
+   void prefetch_snaps();
    void change_view(view_t view);
+   void drop_view(view_t view);
+   
+   /**
+    * Builds the views again, keeping the selection where it can
+    * @param fresh catalogue replacing the current one, or NULL
+    */
+   void rebuild_views(catalogue* fresh);
+   void update_search();
+   void end_search();
+   void search_type(char ch);
+   void search_cycle(int step);
+   void search_erase();
 
    void handle_up();
    void handle_down();
@@ -69,6 +106,10 @@ private:
    void handle_up_menu();
    void handle_down_menu();
    void handle_activate();
+   void handle_search();
+   void handle_favourite();
+   void handle_hide();
+   void handle_show_hidden();
    
 public:
    lemon_menu(lemonui* ui);
@@ -22,6 +22,7 @@
 #include "options.h"
 #include "log.h"
 #include "error.h"
+#include "rotate.h"
 #include "default_font.h"
 
 #include <sys/stat.h>
@@ -29,6 +30,7 @@
 #include <SDL/SDL_image.h>
 #include <SDL/SDL_rotozoom.h>
 #include <cstring>
+#include <sstream>
 
 #define RGB(r,g,b) (((Uint32)b << 16) | ((Uint32)g << 8) | ((Uint32)r))
 #define SDL_RGB(r,g,b) ((SDL_Color){r, g, b})
@@ -83,8 +85,10 @@ int cb_validate_pos_dims(cfg_t *cfg, cfg_opt_t *opt)
 }
 
 lemonui::lemonui(const char* theme_file):
-   _bg(NULL), _snap(NULL), _buffer(NULL), _screen(NULL),
-   _title_font(NULL), _list_font(NULL)
+   _bg(NULL), _snap(NULL), _buffer(NULL), _rotated(NULL), _screen(NULL),
+   _title(NULL), _rmask(0), _gmask(0), _bmask(0),
+   _title_font(NULL), _list_font(NULL),
+   _text_cache(g_opts.get_int(KEY_TEXT_CACHE_SIZE) * 1024)
 {
    _rotate = g_opts.get_int(KEY_ROTATE);
    _scrnw = g_opts.get_int(KEY_SCREEN_WIDTH);
@@ -173,6 +177,15 @@ lemonui::lemonui(const char* theme_file):
    if (_bg == NULL)
       log << warn << "layout: background image not found" << endl;
    
+   // remember which background image prepared snapshots are composited on
+   struct stat bgstat;
+   _bg_stamp.assign(background);
+   if (_bg && stat(background.c_str(), &bgstat) == 0) {
+      ostringstream stamp;
+      stamp << '@' << bgstat.st_mtime << ':' << bgstat.st_size;
+      _bg_stamp.append(stamp.str());
+   }
+   
    cfg_t* title = cfg_getsec(cfg, "title");
    
    _title_rect.x = cfg_getnint(title, "position", 0);
@@ -205,6 +218,9 @@ lemonui::lemonui(const char* theme_file):
    
    _snap_alpha = cfg_getint(snapshot, "alpha");
    
+   _snap_dest.x = _snap_dest.y = _snap_dest.w = _snap_dest.h = 0;
+   _title_dest = _snap_dest;
+   
    // init the font engine
    if (TTF_Init())
       throw bad_lemon("layout: unable to start font engine");
@@ -245,6 +261,9 @@ lemonui::~lemonui()
    if (_bg) // free background image
       SDL_FreeSurface(_bg);
    
+   // free text surfaces before the fonts they are keyed on
+   _text_cache.clear();
+   
    if (_title_font && _list_font) { // free fonts
       TTF_CloseFont(_title_font);
       TTF_CloseFont(_list_font);
@@ -258,11 +277,8 @@ lemonui::~lemonui()
    destroy_screen();
 }
 
-void lemonui::setup_screen() throw(bad_lemon&)
+void lemonui::open_screen() throw(bad_lemon&)
 {
-   // initialize sdl
-   SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_TIMER);
-           
    // hide mouse cursor
    SDL_ShowCursor(SDL_DISABLE);
   
@@ -280,20 +296,97 @@ void lemonui::setup_screen() throw(bad_lemon&)
    
    if (!_screen)
       throw bad_lemon("layou: unable to open screen");
+}
+
+void lemonui::setup_screen() throw(bad_lemon&)
+{
+   // initialize sdl
+   SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_TIMER);
+   
+   open_screen();
    
    /*
     * Should I be using hardware surface?  Most docs/guides suggest no..
     * I pass 0 as the alpha mask.  Surfaces don't need an alpha channel to
     * do per-surface alpha and blitting.  In fact I can't seem to get the
     * fadded snapshot blitting to work at all if the alpha channel is set!
+    * 
+    * When the screen is 32 bit the buffer uses the same color masks so
+    * pixels can be copied (and rotated) straight onto the screen.
     */
+   if (_rmask == 0) {
+      // the video mode never changes, so the masks are only picked once
+      // which lets snapshot loader threads read them without locking
+      if (_screen->format->BitsPerPixel == 32) {
+         _rmask = _screen->format->Rmask;
+         _gmask = _screen->format->Gmask;
+         _bmask = _screen->format->Bmask;
+      } else {
+         _rmask = 0x000000ff;
+         _gmask = 0x0000ff00;
+         _bmask = 0x00ff0000;
+      }
+   }
+   
    _buffer = SDL_CreateRGBSurface(SDL_SWSURFACE,
       _buffw, _buffh, 32, // w,h,bpp
-      0x000000ff, 0x0000ff00, 0x00ff0000, 0x00000000); // rgba masks, for big-endian
+      _rmask, _gmask, _bmask, 0x00000000); // rgba masks
 
    if (!_buffer)
       throw bad_lemon("layout: unable to create drawing buffer");
    
+   // keep the background in the buffer format, it's copied from often
+   if (_bg && (_bg->format->BitsPerPixel != 32 ||
+         _bg->format->Rmask != _rmask || _bg->format->Gmask != _gmask ||
+         _bg->format->Bmask != _bmask || _bg->format->Amask != 0)) {
+      SDL_Surface* bg = SDL_ConvertSurface(_bg, _buffer->format, SDL_SWSURFACE);
+      
+      if (bg) {
+         SDL_FreeSurface(_bg);
+         _bg = bg;
+      }
+   }
+   
+   /*
+    * Rotated frames are written directly to the screen when it has the same
+    * pixel format as the buffer.  Otherwise they go through a persistent
+    * screen sized surface that SDL converts from when copying to the screen.
+    */
+   if (_rotate != 0 && (_screen->format->BitsPerPixel != 32 ||
+         SDL_MUSTLOCK(_screen))) {
+      _rotated = SDL_CreateRGBSurface(SDL_SWSURFACE,
+         _scrnw, _scrnh, 32, _rmask, _gmask, _bmask, 0x00000000);
+      
+      if (!_rotated)
+         throw bad_lemon("layout: unable to create rotation buffer");
+   }
+   
+   // new screen has nothing on it, the whole interface needs drawing
+   SDL_Rect all;
+   all.x = all.y = 0; all.w = _buffw; all.h = _buffh;
+   damage(_bg_damage, all);
+}
+
+void lemonui::release_screen()
+{
+   // the buffers, background, fonts and caches don't depend on the video
+   // subsystem and are kept for when the screen comes back
+   SDL_QuitSubSystem(SDL_INIT_VIDEO);
+   _screen = NULL;
+}
+
+void lemonui::restore_screen() throw(bad_lemon&)
+{
+   if (SDL_InitSubSystem(SDL_INIT_VIDEO) == -1)
+      throw bad_lemon("layout: unable to restart video");
+   
+   // the same video mode comes back with the same pixel format, so the
+   // buffers still suit it
+   open_screen();
+   
+   SDL_Rect all;
+   all.x = all.y = 0; all.w = _buffw; all.h = _buffh;
+   damage(_bg_damage, all);
 }
 
 void lemonui::destroy_screen()
@@ -302,16 +395,132 @@ void lemonui::destroy_screen()
       SDL_FreeSurface(_buffer);
       _buffer = NULL;
    }
+   
+   if (_rotated) { // free rotation buffer
+      SDL_FreeSurface(_rotated);
+      _rotated = NULL;
+   }
       
    SDL_Quit(); // shutdown sdl
 }
 
 void lemonui::snap(SDL_Surface* snap)
 {
-   if (_snap)
+   if (_snap) {
       SDL_FreeSurface(_snap);
+      damage(_snap_damage, _snap_dest);
+   }
    
    _snap = snap;
+   
+   if (_snap) {
+      _snap->refcount++; // caller keeps its own reference
+      _snap_dest = snap_dest(_snap->w, _snap->h);
+      damage(_snap_damage, _snap_dest);
+   }
+}
+
+void lemonui::snap_format(string& key) const
+{
+   ostringstream out;
+   
+   out << "rect=" << _snap_rect.x << ',' << _snap_rect.y << ','
+       << _snap_rect.w << 'x' << _snap_rect.h
+       << " alpha=" << (int)_snap_alpha
+       << " masks=" << hex << _rmask << ',' << _gmask << ',' << _bmask << dec
+       << " bg=" << _bg_stamp;
+   
+   key.assign(out.str());
+}
+
+SDL_Rect lemonui::snap_dest(int w, int h) const
+{
+   // center the snapshot within the target rect
+   SDL_Rect dest;
+   dest.w = w;
+   dest.h = h;
+   dest.x = _snap_rect.x + (_snap_rect.w - w) / 2;
+   dest.y = _snap_rect.y + (_snap_rect.h - h) / 2;
+   
+   return dest;
+}
+
+SDL_Surface* lemonui::prepare_snap(SDL_Surface* snap) const
+{
+   // screen must have been setup once for the pixel format
+   if (_rmask == 0) {
+      SDL_FreeSurface(snap);
+      return NULL;
+   }
+   
+   float xscale = (float)_snap_rect.w / snap->w;
+   float yscale = (float)_snap_rect.h / snap->h;
+
+   // width aspect is larger than target, use 
+   if (xscale > yscale) {
+      xscale = yscale;
+   } else if (yscale > xscale) {
+      yscale = xscale;
+   }
+
+   // created scaled version of snapshot surface
+   SDL_Surface* scaled = rotozoomSurfaceXY(snap, 0.0, xscale, yscale, 0);
+   SDL_FreeSurface(snap);
+   
+   if (!scaled)
+      return NULL;
+   
+   SDL_Surface* prepared = SDL_CreateRGBSurface(SDL_SWSURFACE,
+      scaled->w, scaled->h, 32, _rmask, _gmask, _bmask, 0x00000000);
+   
+   if (!prepared) {
+      SDL_FreeSurface(scaled);
+      return NULL;
+   }
+   
+   // start with the part of the background the snapshot covers
+   SDL_FillRect(prepared, NULL, RGB(0,0,0));
+   if (_bg != NULL)
+      copy_bg(prepared, snap_dest(scaled->w, scaled->h));
+   
+   SDL_BlitSurface(scaled, NULL, prepared, NULL);
+   
+   // rotozoomer surface has alpha channel, clear it to do per-surface alpha blit
+   scaled->format->Amask = 0x00000000;
+   
+   // fill scaled surface with black and do alpha blit
+   SDL_FillRect(scaled, NULL, RGB(0,0,0));
+   SDL_SetAlpha(scaled, SDL_SRCALPHA, _snap_alpha);
+   SDL_BlitSurface(scaled, NULL, prepared, NULL);
+   
+   SDL_FreeSurface(scaled);
+   
+   return prepared;
+}
+
+void lemonui::copy_bg(SDL_Surface* dest, const SDL_Rect& rect) const
+{
+   /*
+    * Blitting from a shared surface isn't safe from several threads (SDL
+    * caches the blit mapping in the source surface) so the rows are copied
+    * by hand.  The background was converted to the buffer format in
+    * setup_screen so no conversion is needed.
+    */
+   int x1 = rect.x < 0? 0 : rect.x;
+   int y1 = rect.y < 0? 0 : rect.y;
+   int x2 = min(rect.x + rect.w, _bg->w);
+   int y2 = min(rect.y + rect.h, _bg->h);
+   
+   if (x2 <= x1 || y2 <= y1 || _bg->format->BitsPerPixel != 32)
+      return;
+   
+   for (int y = y1; y < y2; y++) {
+      Uint8* s = (Uint8*)_bg->pixels + y * _bg->pitch + x1 * 4;
+      Uint8* d = (Uint8*)dest->pixels + (y - rect.y) * dest->pitch +
+            (x1 - rect.x) * 4;
+      
+      memcpy(d, s, (x2 - x1) * 4);
+   }
 }
 
 void lemonui::parse_dimensions(SDL_Rect* rect, cfg_t* sec)
@@ -333,15 +542,71 @@ void lemonui::normalize(const char* path, string& new_path)
    }
 }
 
-void lemonui::render_item(SDL_Surface* buffer, item* i, int yoff)
+/** Returns true when the rect has no area */
+static inline bool empty_rect(const SDL_Rect& r)
+{ return r.w == 0 || r.h == 0; }
+
+/** Returns true if the inner rect is fully contained in the outer rect */
+static bool contains(const SDL_Rect& outer, const SDL_Rect& inner)
+{
+   return inner.x >= outer.x && inner.y >= outer.y &&
+      inner.x + inner.w <= outer.x + outer.w &&
+      inner.y + inner.h <= outer.y + outer.h;
+}
+
+/** Returns the smallest rect containing both a and b */
+static SDL_Rect unite(const SDL_Rect& a, const SDL_Rect& b)
+{
+   if (empty_rect(a)) return b;
+   if (empty_rect(b)) return a;
+   
+   int x1 = a.x < b.x? a.x : b.x;
+   int y1 = a.y < b.y? a.y : b.y;
+   int x2 = a.x + a.w > b.x + b.w? a.x + a.w : b.x + b.w;
+   int y2 = a.y + a.h > b.y + b.h? a.y + a.h : b.y + b.h;
+   
+   SDL_Rect r;
+   r.x = x1; r.y = y1; r.w = x2 - x1; r.h = y2 - y1;
+   return r;
+}
+
+void lemonui::damage(damage_t& layer, const SDL_Rect& rect)
 {
-   SDL_Surface* surface = i->draw(_list_font, _list_color, _list_hover_color);
+   // clip to the buffer, rects outside of it need no redraw
+   int x1 = rect.x < 0? 0 : rect.x;
+   int y1 = rect.y < 0? 0 : rect.y;
+   int x2 = min(rect.x + rect.w, _buffw);
+   int y2 = min(rect.y + rect.h, _buffh);
    
-   SDL_Rect src, dest;
+   if (x2 <= x1 || y2 <= y1) return;
+   
+   SDL_Rect r;
+   r.x = x1; r.y = y1; r.w = x2 - x1; r.h = y2 - y1;
+   layer.push_back(r);
+}
+
+void lemonui::layout_item(const char* text, bool hover, int yoff, list_row& row)
+{
+   row.text.assign(text);
+   row.hover = hover;
+   row.surface = _text_cache.render(_list_font, text,
+         hover? _list_hover_color : _list_color);
+   
+   if (row.surface == NULL) {
+      row.src.x = row.src.y = row.src.w = row.src.h = 0;
+      row.dest = row.src;
+      return;
+   }
+   
+   // pin the surface so the text cache can't free it before compositing
+   row.surface->refcount++;
+   
+   SDL_Rect& src = row.src;
+   SDL_Rect& dest = row.dest;
 
    src.x = 0; src.y = 0;
-   src.w = min(surface->w, _list_rect.w);
-   src.h = surface->h;
+   src.w = min(row.surface->w, _list_rect.w);
+   src.h = row.surface->h;
    
    if (_list_justify == left_justify)
       dest.x = _list_rect.x;
@@ -351,77 +616,51 @@ void lemonui::render_item(SDL_Surface* buffer, item* i, int yoff)
       dest.x = _list_rect.x + ((_list_rect.w - src.w) / 2);
    
    dest.y = yoff;
-   
-   SDL_BlitSurface(surface, &src, buffer, &dest);
-   SDL_FreeSurface(surface);
+   dest.w = src.w;
+   dest.h = src.h;
 }
 
-void lemonui::render(menu* current)
+void lemonui::update_title(menu* current)
 {
-   // clear back buffer
-   if (_bg == NULL)
-      SDL_FillRect(_buffer, NULL, RGB(0,0,0));
-   else
-      SDL_BlitSurface(_bg, NULL, _buffer, NULL);
-
-   // draw the games screen shot
-   if (_snap) {
-      float xscale = (float)_snap_rect.w / _snap->w;
-      float yscale = (float)_snap_rect.h / _snap->h;
-
-      // width aspect is larger than target, use 
-      if (xscale > yscale) {
-         xscale = yscale;
-      } else if (yscale > xscale) {
-         yscale = xscale;
-      }
-
-      // created scaled version of snapshot surface
-      SDL_Surface* scaled = rotozoomSurfaceXY(_snap, 0.0, xscale, yscale, 0);
-      
-      // center the snapshot within the target rect
-      SDL_Rect snap_rect;
-      snap_rect.w = scaled->w;
-      snap_rect.h = scaled->h;
-      snap_rect.x = _snap_rect.x + (_snap_rect.w - snap_rect.w) / 2;
-      snap_rect.y = _snap_rect.y + (_snap_rect.h - snap_rect.h) / 2;
-      
-      SDL_BlitSurface(scaled, NULL, _buffer, &snap_rect);
-      
-      // rotozoomer surface has alpha channel, clear it to do per-surface alpha blit
-      scaled->format->Amask = 0x00000000;
+   _title = _text_cache.render(_title_font, current->text(),
+         RGB_SDL_Color(_title_color));
+   
+   SDL_Rect rect = _title_rect;
+   rect.w = rect.h = 0;
+   
+   if (_title) {
+      // pin the surface so the text cache can't free it before compositing
+      _title->refcount++;
       
-      // fill scaled surface with black and do alpha blit
-      SDL_FillRect(scaled, NULL, RGB(0,0,0));
-      SDL_SetAlpha(scaled, SDL_SRCALPHA, _snap_alpha);
-      SDL_BlitSurface(scaled, NULL, _buffer, &snap_rect);
+      if (_title_justify == right_justify)
+         rect.x += _title_rect.w - _title->w;
+      else if (_title_justify == center_justify)
+         rect.x += (_title_rect.w - _title->w) / 2;
       
-      // free scaled surface
-      SDL_FreeSurface(scaled);
+      rect.w = _title->w;
+      rect.h = _title->h;
    }
-
-   SDL_Surface* title =
-      TTF_RenderText_Blended(_title_font, current->text(), RGB_SDL_Color(_title_color));
-   
-   SDL_Rect title_rect = _title_rect;
    
-   if (_title_justify == right_justify)
-      title_rect.x += _title_rect.w - title->w;
-   else if (_title_justify == center_justify)
-      title_rect.x += (_title_rect.w - title->w) / 2;
+   if (_title_text != current->text()) {
+      damage(_title_damage, unite(_title_dest, rect));
+      _title_text.assign(current->text());
+   }
    
-   // draw title to back buffer
-   SDL_BlitSurface(title, NULL, _buffer, &title_rect);
+   _title_dest = rect;
+}
 
-   // finished with the title surface
-   SDL_FreeSurface(title);
+void lemonui::update_list(menu* current)
+{
+   vector<list_row> rows;
    
-   // only render list of children, if there is any
+   // only layout list of children, if there is any
    if (current->has_children()) {
       int yoff = _list_rect.y + ((_list_rect.h - _list_font_height) / 2);
       
-      // draw the selected item in the middle of the list region
-      render_item(_buffer, current->selected(), yoff);
+      // the selected item goes in the middle of the list region
+      rows.push_back(list_row());
+      layout_item(current->child_text(current->selected()), true, yoff,
+            rows.back());
    
       // set absolute top/bottom of list area
       int top = _list_rect.y;
@@ -430,36 +669,171 @@ void lemonui::render(menu* current)
       int yoff_above = yoff - _list_font_height - _list_item_spacing;
       int yoff_bellow = yoff + _list_font_height + _list_item_spacing;
       
-      vector<item*>::iterator i = current->selected_begin();
+      int i = current->selected();
       
-      // draw items above the selected item
-      if (i != current->first()) {
+      // items above the selected item
+      if (i != 0) {
          do {
             --i;
             
-            render_item(_buffer, *i, yoff_above);
+            rows.push_back(list_row());
+            layout_item(current->child_text(i), false, yoff_above, rows.back());
             yoff_above -= _list_font_height + _list_item_spacing;
-         } while (i != current->first() && yoff_above > top);
+         } while (i != 0 && yoff_above > top);
       }
       
-      // draw items bellow the selected item
-      i = current->selected_begin();
-      while (i+1 != current->last() && yoff_bellow + _list_font_height < bottom) {
+      // items bellow the selected item
+      i = current->selected();
+      while (i+1 != current->size() && yoff_bellow + _list_font_height < bottom) {
          i++;
          
-         render_item(_buffer, *i, yoff_bellow);
+         rows.push_back(list_row());
+         layout_item(current->child_text(i), false, yoff_bellow, rows.back());
          
          yoff_bellow += _list_font_height + _list_item_spacing;
       }
    }
    
+   // compare with the rows drawn last frame, rows are matched on position
+   // and only those whose text or color changed are damaged
+   vector<bool> matched(_rows.size(), false);
+   
+   for (vector<list_row>::iterator r = rows.begin(); r != rows.end(); r++) {
+      SDL_Rect changed = r->dest;
+      
+      for (size_t j = 0; j < _rows.size(); j++) {
+         if (_rows[j].dest.y != r->dest.y) continue;
+         
+         matched[j] = true;
+         if (_rows[j].hover == r->hover && _rows[j].text == r->text)
+            changed.w = changed.h = 0;
+         else
+            changed = unite(_rows[j].dest, r->dest);
+         
+         break;
+      }
+      
+      damage(_list_damage, changed);
+   }
+   
+   // rows that are no longer drawn
+   for (size_t j = 0; j < _rows.size(); j++) {
+      if (!matched[j])
+         damage(_list_damage, _rows[j].dest);
+   }
+   
+   _rows.swap(rows);
+}
+
+void lemonui::compose(const SDL_Rect& clip)
+{
+   SDL_Rect r = clip;
+   SDL_SetClipRect(_buffer, &r);
+   
+   // background layer
+   if (_bg == NULL) {
+      SDL_FillRect(_buffer, &r, RGB(0,0,0));
+   } else {
+      SDL_Rect dest = r;
+      SDL_BlitSurface(_bg, &r, _buffer, &dest);
+   }
+   
+   // snapshot layer, already scaled and faded by snap()
+   if (_snap) {
+      SDL_Rect dest = _snap_dest;
+      SDL_BlitSurface(_snap, NULL, _buffer, &dest);
+   }
+   
+   // title layer
+   if (_title) {
+      SDL_Rect dest = _title_dest;
+      SDL_BlitSurface(_title, NULL, _buffer, &dest);
+   }
+   
+   // list layer
+   for (vector<list_row>::iterator i = _rows.begin(); i != _rows.end(); i++) {
+      if (i->surface == NULL) continue;
+      
+      SDL_Rect src = i->src, dest = i->dest;
+      SDL_BlitSurface(i->surface, &src, _buffer, &dest);
+   }
+   
+   SDL_SetClipRect(_buffer, NULL);
+}
+
+void lemonui::present(vector<SDL_Rect>& rects)
+{
    if (_rotate != 0) {
-      SDL_Surface* tmp = rotozoomSurface(_buffer, _rotate, 1, 0);
-      SDL_BlitSurface(tmp, NULL, _screen, NULL);
-      SDL_UpdateRect(_screen, 0, 0, 0, 0);
-      SDL_FreeSurface(tmp);
+      SDL_Surface* target = _rotated? _rotated : _screen;
+      
+      // transform only the damaged rects, mapping them to screen space
+      for (vector<SDL_Rect>::iterator i = rects.begin(); i != rects.end(); i++)
+         *i = rotate_blit(_buffer, *i, target, _rotate);
+      
+      if (_rotated) {
+         for (vector<SDL_Rect>::iterator i = rects.begin(); i != rects.end(); i++) {
+            SDL_Rect src = *i, dest = *i;
+            SDL_BlitSurface(_rotated, &src, _screen, &dest);
+         }
+      }
+      
+      SDL_UpdateRects(_screen, rects.size(), &rects[0]);
    } else {
-      SDL_BlitSurface(_buffer, NULL, _screen, NULL);
-      SDL_UpdateRect(_screen, 0, 0, 0, 0);
+      for (vector<SDL_Rect>::iterator i = rects.begin(); i != rects.end(); i++) {
+         SDL_Rect src = *i, dest = *i;
+         SDL_BlitSurface(_buffer, &src, _screen, &dest);
+      }
+      
+      SDL_UpdateRects(_screen, rects.size(), &rects[0]);
+   }
+}
+
+void lemonui::render(menu* current)
+{
+   Uint32 start = SDL_GetTicks();
+   
+   // layout the title and list layers, collecting damage as they change
+   update_title(current);
+   update_list(current);
+   
+   // gather damage from all layers, skipping rects already covered
+   vector<SDL_Rect> rects;
+   damage_t* layers[] = { &_bg_damage, &_snap_damage, &_title_damage, &_list_damage };
+   
+   for (int l = 0; l < 4; l++) {
+      for (damage_t::iterator i = layers[l]->begin(); i != layers[l]->end(); i++) {
+         bool covered = false;
+         
+         for (size_t j = 0; j < rects.size() && !covered; j++) {
+            if (contains(rects[j], *i))
+               covered = true;
+            else if (contains(*i, rects[j]))
+               rects.erase(rects.begin() + j--);
+         }
+         
+         if (!covered)
+            rects.push_back(*i);
+      }
+      
+      layers[l]->clear();
+   }
+   
+   // recomposite the damaged regions from the layers and push them out
+   for (vector<SDL_Rect>::iterator i = rects.begin(); i != rects.end(); i++)
+      compose(*i);
+   
+   if (!rects.empty())
+      present(rects);
+   
+   // release the text surfaces pinned for this frame
+   for (vector<list_row>::iterator i = _rows.begin(); i != _rows.end(); i++) {
+      if (i->surface) SDL_FreeSurface(i->surface);
+      i->surface = NULL;
    }
+   
+   if (_title) SDL_FreeSurface(_title);
+   _title = NULL;
+   
+   log << debug << "render: " << rects.size() << " damaged rects, frame took "
+       << SDL_GetTicks() - start << "ms" << endl;
 }
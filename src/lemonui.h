@@ -24,8 +24,10 @@
 #include <SDL/SDL_ttf.h>
 #include <confuse.h>
 #include <string>
+#include <vector>
 #include "error.h"
 #include "menu.h"
+#include "textcache.h"
 
 #define DIMENSION_FULL -1
 
@@ -33,20 +35,42 @@ namespace ll {
 
 typedef enum { left_justify, right_justify, center_justify } justify_t;
 
+/** Regions of a layer that changed since it was last composited */
+typedef vector<SDL_Rect> damage_t;
+
+/** A line of text drawn by the list layer */
+struct list_row {
+   string text;
+   bool hover;
+   SDL_Surface* surface; // pinned text surface, only valid during render
+   SDL_Rect src;         // part of the surface that is drawn
+   SDL_Rect dest;        // position in the drawing buffer
+};
+
 /**
- * Class for handling layout and rendering of the interface
+ * Class for handling layout and rendering of the interface.
+ * 
+ * The interface is composited from four layers: background, snapshot, title
+ * and list.  Each layer records the regions of the buffer it changed, and
+ * only those regions are redrawn and pushed to the screen.
  */
 class lemonui {
 private:
    std::string _theme_dir;
+   std::string _bg_stamp; // background path and modification time
    
    SDL_Surface* _bg;
    SDL_Surface* _snap;
    SDL_Surface* _buffer;
+   SDL_Surface* _rotated; // screen sized rotation target, when needed
    SDL_Surface* _screen;
+   SDL_Surface* _title; // pinned title text surface, only valid during render
+   
+   Uint32 _rmask, _gmask, _bmask; // color masks of the drawing buffer
    
    TTF_Font* _title_font;
    TTF_Font* _list_font;
+   text_cache _text_cache;
    
    SDL_Rect _title_rect;
    Uint32 _title_color;
@@ -66,10 +90,35 @@ private:
    int _rotate;
    
    SDL_Rect _snap_rect;
+   SDL_Rect _snap_dest; // position of the prepared snapshot in the buffer
    Uint8 _snap_alpha;
    
-   /** Render menu item at the given verticle offset */
-   void render_item(SDL_Surface* buffer, item* i, int yoff);
+   string _title_text;       // title text currently in the buffer
+   SDL_Rect _title_dest;     // position of the title in the buffer
+   vector<list_row> _rows;   // list rows currently in the buffer
+   
+   damage_t _bg_damage;
+   damage_t _snap_damage;
+   damage_t _title_damage;
+   damage_t _list_damage;
+   
+   /** Adds the rect, clipped to the buffer, to the layers damage */
+   void damage(damage_t& layer, const SDL_Rect& rect);
+   
+   /** Lays out menu item at the given verticle offset */
+   void layout_item(const char* text, bool hover, int yoff, list_row& row);
+   
+   /** Lays out the title layer, damaging it if the text changed */
+   void update_title(menu* current);
+   
+   /** Lays out the list layer, damaging rows that changed */
+   void update_list(menu* current);
+   
+   /** Redraws all layers inside the clip rect of the buffer */
+   void compose(const SDL_Rect& clip);
+   
+   /** Copies the rects of the buffer to the screen and updates them */
+   void present(vector<SDL_Rect>& rects);
    
    /**
     * Parses the dimensions option from the conf section and fills in the
@@ -85,6 +134,15 @@ private:
     */
    void normalize(const char* path, string& new_path);
    
+   /** Returns the rect of a w x h snapshot centered in the snapshot area */
+   SDL_Rect snap_dest(int w, int h) const;
+   
+   /** Hides the cursor and sets the video mode */
+   void open_screen() throw(bad_lemon&);
+   
+   /** Copies the rect of the background image to the top left of dest */
+   void copy_bg(SDL_Surface* dest, const SDL_Rect& rect) const;
+   
 public:
    /**
     * Creates the layout from the given theme file
@@ -105,13 +163,49 @@ public:
     * Destroy screen and drawing buffer
     */
    void destroy_screen();
+   
+   /**
+    * Closes the screen and shuts down only the video subsystem, so another
+    * program can take the display.  Everything else stays loaded.
+    */
+   void release_screen();
+   
+   /** Opens the screen again after release_screen */
+   void restore_screen() throw(bad_lemon&);
 
    /** Returns number of list items that fit in one page */
    const int page_size() const
    { return _page_size; }
    
    /**
-    * Sets the current snapshot image
+    * Scales the snapshot to fit the snapshot rect, composites it over the
+    * background and applies the fade.  The result is opaque and in the same
+    * format as the drawing buffer so it can be copied with a plain blit.
+    * The snap surface is freed.
+    * 
+    * This is safe to call from any thread once the screen has been setup.
+    * @return newly created surface, or NULL on failure
+    */
+   SDL_Surface* prepare_snap(SDL_Surface* snap) const;
+   
+   /** Returns the area snapshots are scaled to fit */
+   const SDL_Rect& snap_rect() const
+   { return _snap_rect; }
+   
+   /**
+    * Describes everything that affects the output of prepare_snap (snapshot
+    * area, fade, pixel format and background image).  Prepared snapshots
+    * stored with one key can't be reused under a different key.
+    */
+   void snap_format(string& key) const;
+   
+   /** Returns the color masks of surfaces made by prepare_snap */
+   void snap_masks(Uint32& rmask, Uint32& gmask, Uint32& bmask) const
+   { rmask = _rmask; gmask = _gmask; bmask = _bmask; }
+   
+   /**
+    * Sets the current snapshot image, which must have been prepared with
+    * prepare_snap.  The layout takes its own reference to the surface.
     */
    void snap(SDL_Surface* snap);
    
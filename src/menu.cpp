@@ -19,20 +19,53 @@
  */
 
 #include "menu.h"
+#include "catalogue.h"
 #include "options.h"
 #include <cctype>
+#include <algorithm>
 
 using namespace ll;
 
+/** Orders games by name */
+struct cmp_order {
+   const catalogue* c;
+   cmp_order(const catalogue* c) : c(c) { }
+
+   bool operator()(Uint32 left, Uint32 right) const
+   { return c->order(left) < c->order(right); }
+};
+
+/**
+ * Returns the alpha jump bucket of a child's text: 0 for anything but
+ * letters and digits, 1-10 for digits and 11-36 for letters
+ */
+static int letter_bucket(const char* text)
+{
+   int ch = tolower((unsigned char)text[0]);
+   
+   if (ch >= 'a' && ch <= 'z')
+      return ch - 'a' + 11;
+   if (ch >= '0' && ch <= '9')
+      return ch - '0' + 1;
+   return 0;
+}
+
 menu::~menu()
 {
-   for (vector<item*>::iterator i = _children.begin(); i != _children.end(); i++)
+   for (vector<menu*>::iterator i = _menus.begin(); i != _menus.end(); i++)
       delete *i;
 }
 
+const char* menu::child_text(int index) const
+{
+   if (_menus.empty())
+      return _catalogue->name(_games[index]);
+   return _menus[index]->text();
+}
+
 const bool menu::select_next(int step)
 {
-   int last = _children.size()-1;
+   int last = size()-1;
    if (_selected < last) {
       _selected = _selected + step <= last? _selected + step : last;
       return true;
@@ -53,12 +86,25 @@ const bool menu::select_previous(int step)
 
 const bool menu::select_next_alpha()
 {
-   // first character of selected child in lowercase
-   int sel_ch = tolower(_children[_selected]->text()[0]);
+   if (!has_children()) return false;
+   
+   int sel = letter_bucket(child_text(_selected));
+   
+   if (_letter_order) {
+      // the next child in alphabetic order starts the next used bucket
+      for (int b = sel+1; b < LETTER_BUCKETS; b++) {
+         if (_letters[b] >= 0) {
+            _selected = _letters[b];
+            return true;
+         }
+      }
+      
+      return false;
+   }
 
    // iterate over children to find next in alphabetic order
-   for (int i=_selected, last=_children.size()-1; i <= last; i++) {
-      if (tolower(_children[i]->text()[0]) > sel_ch) {
+   for (int i=_selected, last=size()-1; i <= last; i++) {
+      if (letter_bucket(child_text(i)) > sel) {
          _selected = i;
          return true;
       }
@@ -69,12 +115,23 @@ const bool menu::select_next_alpha()
 
 const bool menu::select_previous_alpha()
 {
-   // first character of selected child in lowercase
-   int sel_ch = tolower(_children[_selected]->text()[0]);
+   if (!has_children()) return false;
+   
+   int sel = letter_bucket(child_text(_selected));
+   
+   if (_letter_order) {
+      // the child before the selected bucket's first is the previous one
+      if (_letters[sel] > 0) {
+         _selected = _letters[sel] - 1;
+         return true;
+      }
+      
+      return false;
+   }
 
    // iterate over children to find privious in alphabetic order
    for (int i=_selected; i >= 0; i--) {
-      if (tolower(_children[i]->text()[0]) < sel_ch) {
+      if (letter_bucket(child_text(i)) < sel) {
          _selected = i;
          return true;
       }
@@ -83,8 +140,150 @@ const bool menu::select_previous_alpha()
    return false;
 }
 
-SDL_Surface* menu::draw(TTF_Font* font, SDL_Color color, SDL_Color hover_color) const
+void menu::index_child(int index)
+{
+   if (!_letter_order) return;
+   
+   int bucket = letter_bucket(child_text(index));
+   
+   if (_letters[bucket] < 0) {
+      // a new bucket must come after every bucket seen so far
+      for (int b = bucket+1; b < LETTER_BUCKETS; b++)
+         if (_letters[b] >= 0) _letter_order = false;
+      
+      _letters[bucket] = index;
+   } else if (letter_bucket(child_text(index-1)) != bucket) {
+      // bucket seen before, but not as the previous child
+      _letter_order = false;
+   }
+}
+
+void menu::insert_game(Uint32 g)
+{
+   vector<Uint32>::iterator i = lower_bound(_games.begin(), _games.end(), g,
+         cmp_order(_catalogue));
+   insert_game(i - _games.begin(), g);
+}
+
+void menu::insert_game(int index, Uint32 g)
 {
-   SDL_Color c = parent() && this == ((menu*)parent())->selected()? hover_color : color;
-   return TTF_RenderText_Blended(font, text(), c);
+   _games.insert(_games.begin() + index, g);
+   
+   // keep the same child selected
+   if (_games.size() > 1 && index <= _selected)
+      _selected++;
+   
+   // children from the insert on moved down one
+   int bucket = letter_bucket(child_text(index));
+   for (int b = 0; b < LETTER_BUCKETS; b++)
+      if (_letters[b] >= index) _letters[b]++;
+   
+   if (_letters[bucket] < 0 || _letters[bucket] > index)
+      _letters[bucket] = index;
+   
+   // names are sorted case sensitively, the buckets may end up out of order
+   if ((index > 0 && letter_bucket(child_text(index-1)) > bucket) ||
+         (index < size()-1 && letter_bucket(child_text(index+1)) < bucket))
+      _letter_order = false;
+}
+
+bool menu::remove_game(Uint32 g)
+{
+   vector<Uint32>::iterator i = find(_games.begin(), _games.end(), g);
+   if (i == _games.end())
+      return false;
+   
+   int index = i - _games.begin();
+   int bucket = letter_bucket(child_text(index));
+   _games.erase(i);
+   
+   removed_child(index, bucket);
+   return true;
+}
+
+bool menu::remove_menu(menu* m)
+{
+   vector<menu*>::iterator i = find(_menus.begin(), _menus.end(), m);
+   if (i == _menus.end())
+      return false;
+   
+   int index = i - _menus.begin();
+   int bucket = letter_bucket(child_text(index));
+   _menus.erase(i);
+   delete m;
+   
+   removed_child(index, bucket);
+   return true;
+}
+
+void menu::removed_child(int index, int bucket)
+{
+   // keep the same child selected, or the one after a removed selection
+   if (index < _selected || _selected == size())
+      _selected = _selected > 0? _selected - 1 : 0;
+   
+   // the bucket may have lost its only child, later children moved up one
+   if (_letters[bucket] == index &&
+         (index == size() || letter_bucket(child_text(index)) != bucket))
+      _letters[bucket] = -1;
+   
+   for (int b = 0; b < LETTER_BUCKETS; b++)
+      if (_letters[b] > index) _letters[b]--;
+}
+
+bool menu::select_game(Uint32 g)
+{
+   vector<Uint32>::const_iterator i = find(_games.begin(), _games.end(), g);
+   if (i == _games.end())
+      return false;
+   
+   _selected = i - _games.begin();
+   return true;
+}
+
+void menu::load()
+{
+   if (_loaded) return;
+   
+   int selected = _selected;
+   
+   _games.reserve(_last - _first);
+   for (Uint32 i = _first; i < _last; i++) {
+      Uint32 g = (*_source)[i];
+      if (_show_hidden || !_catalogue->hidden(g))
+         add_game(g);
+   }
+   
+   _selected = selected < size()? selected : 0;
+   _loaded = true;
+}
+
+void menu::unload()
+{
+   if (!_source || !_loaded) return;
+   
+   int selected = _selected;
+   
+   clear();
+   vector<Uint32>().swap(_games);
+   
+   _selected = selected;
+   _loaded = false;
+}
+
+void menu::collect_games(vector<Uint32>& games) const
+{
+   if (!_loaded) {
+      // list the range without loading the menu
+      for (Uint32 i = _first; i < _last; i++) {
+         Uint32 g = (*_source)[i];
+         if (_show_hidden || !_catalogue->hidden(g))
+            games.push_back(g);
+      }
+   }
+   
+   games.insert(games.end(), _games.begin(), _games.end());
+   
+   for (vector<menu*>::const_iterator i = _menus.begin(); i != _menus.end(); i++)
+      (*i)->collect_games(games);
 }
@@ -20,40 +20,118 @@
 #ifndef MENU_H_
 #define MENU_H_
 
-#include "item.h"
+#include <SDL/SDL.h>
 #include <vector>
 #include <string>
 
 using namespace std;
 
+/* leading character buckets of the alpha jumps: other, 0-9 then a-z */
+#define LETTER_BUCKETS 37
+
 namespace ll {
 
+class catalogue;
+
 /**
- * Menu item class
+ * Menu class, holds either games (as catalogue indices) or sub menus.
+ *
+ * A menu may instead describe its games as a range of a catalogue view,
+ * in which case they are only listed when the menu is loaded and may be
+ * unloaded again to free them.
  */
-class menu : public item {
+class menu {
 private:
    string _name; // menu name
-   vector<item*> _children; // array of children
+   menu* _parent; // menu this is a sub menu of, NULL for the top menu
+   const catalogue* _catalogue; // games are looked up here
+   vector<Uint32> _games; // catalogue indices of child games
+   vector<menu*> _menus; // child menus, owned by this menu
    int _selected; // index of selected child
+   
+   /*
+    * First child in each leading character bucket, -1 for empty buckets.
+    * Only used while the children are in bucket order.
+    */
+   vector<int> _letters;
+   bool _letter_order;
+   
+   /* games of a lazily loaded menu, a range of a catalogue view */
+   const vector<Uint32>* _source;
+   Uint32 _first;
+   Uint32 _last;
+   bool _show_hidden;
+   bool _loaded;
+   
+   /** Records the leading character of a child, children are added in order */
+   void index_child(int index);
+   
+   /**
+    * Keeps the selection and leading characters after a child was removed
+    * @param bucket leading character bucket of the removed child
+    */
+   void removed_child(int index, int bucket);
+   
 
 public:
-   menu(const char* name) :
-      _name(name), _selected(0) { }
+   menu(const char* name, const catalogue* games) :
+      _name(name), _parent(NULL), _catalogue(games), _selected(0),
+      _letters(LETTER_BUCKETS, -1), _letter_order(true),
+      _source(NULL), _first(0), _last(0), _show_hidden(false), _loaded(true) { }
    
-   virtual ~menu();
+   /**
+    * Creates a menu of the games in [first, last) of a catalogue view,
+    * which are listed when the menu is loaded
+    * @param show_hidden list hidden and missing games too
+    */
+   menu(const char* name, const catalogue* games, const vector<Uint32>& view,
+         Uint32 first, Uint32 last, bool show_hidden) :
+      _name(name), _parent(NULL), _catalogue(games), _selected(0),
+      _letters(LETTER_BUCKETS, -1), _letter_order(true),
+      _source(&view), _first(first), _last(last), _show_hidden(show_hidden),
+      _loaded(false) { }
+   
+   /** Deletes sub menus */
+   ~menu();
+
+   /** Returns the menu this is a sub menu of, or NULL */
+   menu* parent() const
+   { return _parent; }
 
    /** Returns true if there is 1 or more children */
    const bool has_children() const
-   { return ! _children.empty(); }
+   { return size() > 0; }
+   
+   /** Returns true if the children are menus rather than games */
+   const bool has_menus() const
+   { return !_menus.empty(); }
+   
+   /** Returns number of children */
+   int size() const
+   { return _menus.empty()? _games.size() : _menus.size(); }
+   
+   /** Returns index of the currently selected child */
+   int selected() const
+   { return _selected; }
+   
+   /** Returns the text of a child */
+   const char* child_text(int index) const;
    
-   /** Returns currently selected child */
-   item* selected()
-   { return _children[_selected]; }
+   /** Returns the catalogue index of a child game */
+   Uint32 game(int index) const
+   { return _games[index]; }
    
-   /** Returns currently selected child as a bi-directional iterator */
-   vector<item*>::iterator selected_begin()
-   { return _children.begin()+_selected; }
+   /** Returns a child menu */
+   menu* sub_menu(int index) const
+   { return _menus[index]; }
+   
+   /** Returns catalogue index of the selected game */
+   Uint32 selected_game() const
+   { return _games[_selected]; }
+   
+   /** Returns the selected menu */
+   menu* selected_menu() const
+   { return _menus[_selected]; }
 
    /**
     * Attempts to select the child who is 'step' number of children
@@ -82,37 +160,92 @@ public:
     * @return true if selection has changed
     */
    const bool select_previous_alpha();
-
+   
+   /** Reserves room for the given number of games */
+   void reserve(size_t count)
+   { _games.reserve(count); }
+   
+   /** Appends a game to the end of the children list */
+   void add_game(Uint32 g)
+   {
+      _games.push_back(g);
+      index_child(_games.size()-1);
+   }
+   
    /**
-    * Returns iterator to first child item
+    * Inserts a game into a menu of games in alphabetic order, keeping the
+    * same child selected
     */
-   vector<item*>::iterator first()
-   { return _children.begin(); }
+   void insert_game(Uint32 g);
+   
+   /** Inserts a game at a position, keeping the same child selected */
+   void insert_game(int index, Uint32 g);
    
    /**
-    * Returns iterator to one past last child item
+    * Removes a game, keeping the same child selected or else the child
+    * after it
+    * @return false if the game isn't a child of this menu
     */
-   vector<item*>::iterator last()
-   { return _children.end(); }
+   bool remove_game(Uint32 g);
    
-   /** Appends the child item to the end of the children list */
-   void add_child(item* item)
+   /**
+    * Removes and deletes a sub menu, keeping the same child selected or
+    * else the child after it
+    * @return false if the menu isn't a child of this menu
+    */
+   bool remove_menu(menu* m);
+   
+   /** Appends a sub menu to the end of the children list and owns it */
+   void add_menu(menu* m)
    {
-      item->parent(this);
-      _children.push_back(item);
+      m->_parent = this;
+      _menus.push_back(m);
+      index_child(_menus.size()-1);
    }
 
+   /** Removes the child games and selects the first child */
+   void clear()
+   {
+      _games.clear();
+      _selected = 0;
+      _letters.assign(LETTER_BUCKETS, -1);
+      _letter_order = true;
+   }
+   
+   /** Selects a child by index, if there is such a child */
+   void select(int index)
+   { if (index >= 0 && index < size()) _selected = index; }
+   
+   /**
+    * Selects the child game with the given catalogue index
+    * @return false if the game isn't a child of this menu
+    */
+   bool select_game(Uint32 g);
+   
+   /** Appends the games of this menu and its sub menus, in menu order */
+   void collect_games(vector<Uint32>& games) const;
+   
+   /** Returns true if the games of the menu are listed */
+   bool loaded() const
+   { return _loaded; }
+   
+   /** Returns where the games of a lazily loaded menu start in their view */
+   Uint32 first() const
+   { return _first; }
+   
+   /** Lists the games of a lazily loaded menu */
+   void load();
+   
+   /** Frees the games of a lazily loaded menu, keeping the selection */
+   void unload();
+   
+   /** Changes the menu name */
+   void rename(const string& name)
+   { _name = name; }
+   
    /** Return menu name as item text */
    const char* text() const
    { return _name.c_str(); }
-   
-   SDL_Surface* draw(TTF_Font* font, SDL_Color color, SDL_Color hover_color) const;
-   
-   /* Roland's origional version would iterate through all games in the menu and
-    * look for four game snapshots to be placed in a 2x2 grid.  Would be cool if
-    * this was not just limited to a 2x2 grid but the performance would be horrible!
-    * So, this is skipped until something better can be conjured up. */
-   SDL_Surface* snapshot() { return NULL; }
 };
 
 } // end namespace
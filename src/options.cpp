@@ -47,6 +47,20 @@ int cb_rotate(cfg_t *cfg, cfg_opt_t *opt, const char *value, void *result)
    return 0;
 }
 
+int cb_launch_mode(cfg_t *cfg, cfg_opt_t *opt, const char *value, void *result)
+{
+   if (strcmp(value, "spawn") == 0)
+      *(int *)result = LAUNCH_SPAWN;
+   else if (strcmp(value, "system") == 0)
+      *(int *)result = LAUNCH_SYSTEM;
+   else {
+      cfg_error(cfg, "invalid value for option %s: %s", opt->name, value);
+      return -1;
+   }
+   
+   return 0;
+}
+
 options::options() : _cfg(NULL) { }
 
 void options::load(const char* conf_dir)
@@ -64,9 +78,22 @@ void options::load(const char* conf_dir)
       
       CFG_STR(KEY_SKIN_FILE, "", CFGF_NONE),
       CFG_INT(KEY_SNAPSHOT_DELAY, 500, CFGF_NONE),
+      CFG_INT(KEY_TEXT_CACHE_SIZE, 2048, CFGF_NONE),
+      CFG_INT(KEY_SNAPSHOT_THREADS, 2, CFGF_NONE),
+      CFG_INT(KEY_SNAPSHOT_PREFETCH, 2, CFGF_NONE),
+      CFG_INT(KEY_SNAPSHOT_CACHE_SIZE, 32768, CFGF_NONE),
+      CFG_BOOL(KEY_THUMBNAIL_CACHE, cfg_true, CFGF_NONE),
       
       CFG_STR(KEY_MAME_PATH, "mame %r", CFGF_NONE),
       CFG_STR(KEY_MAME_SNAP_PATH, "", CFGF_NONE),
+      CFG_STR(KEY_SNAP_ARCHIVE, "", CFGF_NONE),
+      CFG_INT_CB(KEY_LAUNCH_MODE, LAUNCH_SPAWN, CFGF_NONE, &cb_launch_mode),
+      CFG_STR(KEY_ROM_PATH, "", CFGF_NONE),
+      CFG_INT(KEY_ROM_READAHEAD, 131072, CFGF_NONE),
+      CFG_STR(KEY_LAUNCH_STATS, "", CFGF_NONE),
+      CFG_INT(KEY_STARTUP_TIMEOUT, 0, CFGF_NONE),
+      CFG_INT(KEY_IDLE_TIMEOUT, 0, CFGF_NONE),
+      CFG_INT(KEY_KILL_KEY, 0, CFGF_NONE),
       
       CFG_INT(KEY_KEYCODE_EXIT, 27, CFGF_NONE),
       CFG_INT(KEY_KEYCODE_UP, 273, CFGF_NONE),
@@ -77,6 +104,10 @@ void options::load(const char* conf_dir)
       CFG_INT(KEY_KEYCODE_BACK, 50, CFGF_NONE),
       CFG_INT(KEY_KEYCODE_ALPHAMOD, 64, CFGF_NONE),
       CFG_INT(KEY_KEYCODE_VIEWMOD, 256, CFGF_NONE),
+      CFG_INT(KEY_KEYCODE_SEARCH, 47, CFGF_NONE),
+      CFG_INT(KEY_KEYCODE_FAVOURITE, 304, CFGF_NONE),
+      CFG_INT(KEY_KEYCODE_HIDE, 122, CFGF_NONE),
+      CFG_INT(KEY_KEYCODE_SHOW_HIDDEN, 120, CFGF_NONE),
       CFG_END()
    };
    
@@ -38,10 +38,27 @@ namespace ll {
 /* Ui settings */
 #define KEY_SKIN_FILE       "theme"
 #define KEY_SNAPSHOT_DELAY  "snapshot_delay"
+#define KEY_TEXT_CACHE_SIZE "text_cache_size" /* kilobytes of rendered text */
+#define KEY_SNAPSHOT_THREADS  "snapshot_threads"  /* snapshot loader threads */
+#define KEY_SNAPSHOT_PREFETCH "snapshot_prefetch" /* items above/below to load */
+#define KEY_SNAPSHOT_CACHE_SIZE "snapshot_cache_size" /* kilobytes of snaps */
+#define KEY_THUMBNAIL_CACHE "thumbnail_cache" /* keep prepared snaps on disk */
 
 /* MAME settings */
 #define KEY_MAME_PATH       "mame"
 #define KEY_MAME_SNAP_PATH  "snap"
+#define KEY_SNAP_ARCHIVE    "snap_archive"
+#define KEY_LAUNCH_MODE     "launch_mode" /* spawn or system, see below */
+#define KEY_ROM_PATH        "rom_path"    /* rom directories, ; separated */
+#define KEY_ROM_READAHEAD   "rom_readahead" /* kilobytes of roms to warm */
+#define KEY_LAUNCH_STATS    "launch_stats" /* file launch timings are added to */
+#define KEY_STARTUP_TIMEOUT "startup_timeout" /* seconds to first input */
+#define KEY_IDLE_TIMEOUT    "idle_timeout"    /* seconds between inputs */
+#define KEY_KILL_KEY        "kill_key"  /* linux key code stopping the game */
+
+/* values of the launch mode option */
+#define LAUNCH_SYSTEM 0 /* run through the shell with SDL shut down */
+#define LAUNCH_SPAWN  1 /* start directly, only the screen is released */
 
 /* Key mapping */
 #define KEY_KEYCODE_EXIT      "exit"
@@ -53,6 +70,10 @@ namespace ll {
 #define KEY_KEYCODE_BACK      "back"
 #define KEY_KEYCODE_ALPHAMOD  "alphamod"
 #define KEY_KEYCODE_VIEWMOD   "viewmod"
+#define KEY_KEYCODE_SEARCH    "search"
+#define KEY_KEYCODE_FAVOURITE "favourite"
+#define KEY_KEYCODE_HIDE      "hide"
+#define KEY_KEYCODE_SHOW_HIDDEN "show_hidden"
 
 /**
  * Class for reading configuration file.  Settings are accessed by passing
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "romwarmer.h"
+#include "options.h"
+#include "log.h"
+
+#ifdef HAVE_POSIX_FADVISE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#endif
+
+/* bytes read ahead between checks for a new request */
+#define WARM_STEP (4 << 20)
+
+/* bytes read into the scratch buffer at a time */
+#define READ_CHUNK (256 << 10)
+
+using namespace ll;
+using namespace std;
+
+rom_warmer::rom_warmer() :
+   _limit((Uint64)g_opts.get_int(KEY_ROM_READAHEAD) * 1024),
+   _thread(NULL), _lock(NULL), _wake(NULL), _quit(false), _requests(0)
+{
+   // directories are separated by semicolons, like mame's rompath
+   string paths(g_opts.get_string(KEY_ROM_PATH));
+   size_t start = 0;
+
+   while (start <= paths.size()) {
+      size_t end = paths.find(';', start);
+      if (end == string::npos) end = paths.size();
+
+      if (end > start)
+         _paths.push_back(paths.substr(start, end - start));
+      start = end + 1;
+   }
+
+   if (_paths.empty() || _limit == 0)
+      return;
+
+#ifdef HAVE_POSIX_FADVISE
+   _scratch.resize(READ_CHUNK);
+   _lock = SDL_CreateMutex();
+   _wake = SDL_CreateCond();
+   _thread = SDL_CreateThread(&rom_warmer::worker, this);
+
+   if (_thread)
+      log << info << "rom_warmer: reading ahead up to " << _limit / 1024
+          << "k of the selected game's roms" << endl;
+   else
+      log << warn << "rom_warmer: unable to start thread" << endl;
+#else
+   log << warn << "rom_warmer: read ahead not supported, rom_path unused" << endl;
+#endif
+}
+
+rom_warmer::~rom_warmer()
+{
+   if (_thread) {
+      SDL_mutexP(_lock);
+      _quit = true;
+      _requests++;
+      SDL_CondSignal(_wake);
+      SDL_mutexV(_lock);
+
+      SDL_WaitThread(_thread, NULL);
+   }
+
+   if (_wake) SDL_DestroyCond(_wake);
+   if (_lock) SDL_DestroyMutex(_lock);
+}
+
+void rom_warmer::request(const vector<string>& roms)
+{
+   if (!_thread)
+      return;
+
+   SDL_mutexP(_lock);
+   _wanted = roms;
+   _requests++;
+   SDL_CondSignal(_wake);
+   SDL_mutexV(_lock);
+}
+
+void rom_warmer::cancel()
+{
+   if (!_thread)
+      return;
+
+   SDL_mutexP(_lock);
+   _wanted.clear();
+   _requests++;
+   SDL_mutexV(_lock);
+}
+
+bool rom_warmer::cancelled(Uint32 ticket)
+{
+   SDL_mutexP(_lock);
+   bool changed = _requests != ticket;
+   SDL_mutexV(_lock);
+
+   return changed;
+}
+
+void rom_warmer::run()
+{
+   SDL_mutexP(_lock);
+
+   while (!_quit) {
+      if (_wanted.empty()) {
+         SDL_CondWait(_wake, _lock);
+         continue;
+      }
+
+      vector<string> roms;
+      roms.swap(_wanted);
+      Uint32 ticket = _requests;
+
+      SDL_mutexV(_lock);
+
+      Uint64 budget = _limit;
+      for (vector<string>::iterator r = roms.begin(); r != roms.end(); r++) {
+         for (vector<string>::iterator p = _paths.begin(); p != _paths.end(); p++) {
+            string base(*p + '/' + *r);
+
+            warm(base + ".zip", ticket, budget);
+            warm(base + ".7z", ticket, budget);
+            warm(base, ticket, budget);
+         }
+      }
+
+      SDL_mutexP(_lock);
+   }
+
+   SDL_mutexV(_lock);
+}
+
+void rom_warmer::warm(const string& path, Uint32 ticket, Uint64& budget)
+{
+#ifdef HAVE_POSIX_FADVISE
+   struct stat st;
+   if (budget == 0 || stat(path.c_str(), &st) != 0)
+      return;
+
+   if (S_ISREG(st.st_mode)) {
+      warm_file(path, ticket, budget);
+      return;
+   }
+
+   if (!S_ISDIR(st.st_mode))
+      return;
+
+   DIR* dir = opendir(path.c_str());
+   if (!dir)
+      return;
+
+   struct dirent* ent;
+   while (budget > 0 && (ent = readdir(dir)) != NULL) {
+      string file(path + '/' + ent->d_name);
+
+      // only the files directly in the rom directory
+      if (ent->d_name[0] != '.' && stat(file.c_str(), &st) == 0 &&
+            S_ISREG(st.st_mode))
+         warm_file(file, ticket, budget);
+   }
+
+   closedir(dir);
+#endif
+}
+
+void rom_warmer::warm_file(const string& file, Uint32 ticket, Uint64& budget)
+{
+#ifdef HAVE_POSIX_FADVISE
+   int fd = open(file.c_str(), O_RDONLY);
+   if (fd == -1)
+      return;
+
+   struct stat st;
+   if (fstat(fd, &st) == 0) {
+      Uint64 size = st.st_size;
+
+      // a step at a time so a new selection doesn't wait for a whole chd
+      for (Uint64 offset = 0; offset < size && budget > 0; ) {
+         if (cancelled(ticket)) {
+            budget = 0;
+            break;
+         }
+
+         Uint64 len = size - offset;
+         if (len > WARM_STEP) len = WARM_STEP;
+         if (len > budget) len = budget;
+
+         // the advice gets the whole step read in large requests, reading
+         // it waits until it's in, so a cancel takes effect at the next step
+         posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED);
+         Uint64 got = read_step(fd, offset, len);
+
+         offset += got;
+         budget -= got;
+         if (got < len)
+            break;
+      }
+   }
+
+   // pages read ahead stay cached after closing
+   close(fd);
+#endif
+}
+
+Uint64 rom_warmer::read_step(int fd, Uint64 offset, Uint64 len)
+{
+   Uint64 done = 0;
+
+#ifdef HAVE_POSIX_FADVISE
+   while (done < len) {
+      size_t want = len - done < READ_CHUNK? len - done : READ_CHUNK;
+      ssize_t n = pread(fd, &_scratch[0], want, offset + done);
+
+      if (n == -1 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         break;
+
+      done += n;
+   }
+#endif
+
+   return done;
+}
+
+int rom_warmer::worker(void* data)
+{
+   ((rom_warmer*)data)->run();
+   return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef ROMWARMER_H_
+#define ROMWARMER_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Warms the page cache with the rom files of the game the user is dwelling
+ * on, so the emulator doesn't start with a cold read of a large rom set from
+ * a slow disk or network share.  A background thread reads the files
+ * through a scratch buffer a few megabytes at a time, each step also
+ * advised with posix_fadvise so the kernel reads it in large requests, up
+ * to a limit per request.  A step isn't done until its data is in, so a
+ * new request or a cancel stops warming the old one within a step.
+ *
+ * Each rom is looked for in every rom_path directory as rom.zip, rom.7z and
+ * the files of the rom directory (where unzipped roms and CHDs are kept).
+ * Warming is disabled when rom_path isn't set or posix_fadvise is missing.
+ */
+class rom_warmer {
+private:
+   vector<string> _paths; // directories holding roms
+   Uint64 _limit;         // bytes warmed per request at most
+   vector<char> _scratch; // file data is read into this and dropped
+
+   SDL_Thread* _thread;
+   SDL_mutex* _lock;
+   SDL_cond* _wake;
+   bool _quit;
+
+   vector<string> _wanted; // roms of the next request, empty if none
+   Uint32 _requests;       // counts requests and cancels
+
+   /** True if there has been a request or cancel since the ticket was taken */
+   bool cancelled(Uint32 ticket);
+
+   /**
+    * Reads ahead a file, or the files of a directory.
+    * @param budget bytes left to warm, reduced by what was read ahead
+    */
+   void warm(const string& path, Uint32 ticket, Uint64& budget);
+
+   /** Reads ahead a single file */
+   void warm_file(const string& file, Uint32 ticket, Uint64& budget);
+
+   /**
+    * Reads part of a file into the scratch buffer
+    * @return bytes read, less than asked at the end of the file or on error
+    */
+   Uint64 read_step(int fd, Uint64 offset, Uint64 len);
+
+   /** Thread main loop */
+   void run();
+
+   /** Thread entry point, data is the warmer */
+   static int worker(void* data);
+
+public:
+   /** Reads the rom path and starts the thread */
+   rom_warmer();
+
+   /** Stops the thread, after the read ahead step it is on */
+   ~rom_warmer();
+
+   /** Returns true if roms are being warmed at all */
+   bool enabled() const
+   { return _thread != NULL; }
+
+   /**
+    * Replaces whatever is being warmed.  Roms are warmed in the order given
+    * until the limit is reached.
+    */
+   void request(const vector<string>& roms);
+
+   /** Stops warming */
+   void cancel();
+};
+
+} // end namespace
+
+#endif
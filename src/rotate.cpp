@@ -0,0 +1,151 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "rotate.h"
+
+/*
+ * Size of the square tiles the 90/270 degree transpose works on.  A tile of
+ * source rows and the destination rows it scatters into (2 * 32 * 32 * 4
+ * bytes) fits comfortably in L1 cache.
+ */
+#define TILE 32
+
+using namespace ll;
+
+/**
+ * Rotates a w x h block of pixels 90 degrees counter-clockwise.  Source
+ * pixel (x,y) is written to destination pixel (y, w-1-x).  Pitches are in
+ * pixels, not bytes.
+ */
+static void rotate_90(const Uint32* src, int spitch, Uint32* dst, int dpitch,
+      int w, int h)
+{
+   for (int ty = 0; ty < h; ty += TILE) {
+      int th = h - ty < TILE? h - ty : TILE;
+
+      for (int tx = 0; tx < w; tx += TILE) {
+         int tw = w - tx < TILE? w - tx : TILE;
+
+         // each destination row is a source column, write rows contiguously
+         for (int x = tx; x < tx + tw; x++) {
+            const Uint32* s = src + ty * spitch + x;
+            Uint32* d = dst + (w - 1 - x) * dpitch + ty;
+
+            for (int y = 0; y < th; y++)
+               d[y] = s[y * spitch];
+         }
+      }
+   }
+}
+
+/**
+ * Rotates a w x h block of pixels 270 degrees counter-clockwise.  Source
+ * pixel (x,y) is written to destination pixel (h-1-y, x).
+ */
+static void rotate_270(const Uint32* src, int spitch, Uint32* dst, int dpitch,
+      int w, int h)
+{
+   for (int ty = 0; ty < h; ty += TILE) {
+      int th = h - ty < TILE? h - ty : TILE;
+
+      for (int tx = 0; tx < w; tx += TILE) {
+         int tw = w - tx < TILE? w - tx : TILE;
+
+         for (int x = tx; x < tx + tw; x++) {
+            const Uint32* s = src + (ty + th - 1) * spitch + x;
+            Uint32* d = dst + x * dpitch + (h - ty - th);
+
+            for (int y = 0; y < th; y++)
+               d[y] = s[-y * spitch];
+         }
+      }
+   }
+}
+
+/**
+ * Rotates a w x h block of pixels 180 degrees.  Source pixel (x,y) is
+ * written to destination pixel (w-1-x, h-1-y).
+ */
+static void rotate_180(const Uint32* src, int spitch, Uint32* dst, int dpitch,
+      int w, int h)
+{
+   for (int y = 0; y < h; y++) {
+      const Uint32* s = src + y * spitch;
+      Uint32* d = dst + (h - 1 - y) * dpitch + (w - 1);
+
+      for (int x = 0; x < w; x++)
+         d[-x] = s[x];
+   }
+}
+
+SDL_Rect ll::rotate_rect(const SDL_Rect& rect, int angle, int src_w, int src_h)
+{
+   SDL_Rect r = rect;
+
+   switch (angle) {
+   case 90:
+      r.x = rect.y;
+      r.y = src_w - (rect.x + rect.w);
+      r.w = rect.h;
+      r.h = rect.w;
+      break;
+
+   case 180:
+      r.x = src_w - (rect.x + rect.w);
+      r.y = src_h - (rect.y + rect.h);
+      break;
+
+   case 270:
+      r.x = src_h - (rect.y + rect.h);
+      r.y = rect.x;
+      r.w = rect.h;
+      r.h = rect.w;
+      break;
+   }
+
+   return r;
+}
+
+SDL_Rect ll::rotate_blit(SDL_Surface* src, const SDL_Rect& rect,
+      SDL_Surface* dst, int angle)
+{
+   SDL_Rect out = rotate_rect(rect, angle, src->w, src->h);
+
+   const int spitch = src->pitch / 4;
+   const int dpitch = dst->pitch / 4;
+
+   const Uint32* s = (const Uint32*)src->pixels + rect.y * spitch + rect.x;
+   Uint32* d = (Uint32*)dst->pixels + out.y * dpitch + out.x;
+
+   switch (angle) {
+   case 90:
+      rotate_90(s, spitch, d, dpitch, rect.w, rect.h);
+      break;
+
+   case 180:
+      rotate_180(s, spitch, d, dpitch, rect.w, rect.h);
+      break;
+
+   case 270:
+      rotate_270(s, spitch, d, dpitch, rect.w, rect.h);
+      break;
+   }
+
+   return out;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef ROTATE_H_
+#define ROTATE_H_
+
+#include <SDL/SDL.h>
+
+namespace ll {
+
+/**
+ * Returns where the rect of a src_w x src_h surface ends up after the
+ * surface is rotated counter-clockwise by angle degrees (90, 180 or 270).
+ * The orientation matches rotozoomSurface.
+ */
+SDL_Rect rotate_rect(const SDL_Rect& rect, int angle, int src_w, int src_h);
+
+/**
+ * Copies the rect of the src surface into dst, rotated counter-clockwise
+ * by angle degrees (90, 180 or 270).  This is a lossless transpose/flip,
+ * no pixels are interpolated and nothing is allocated.
+ *
+ * Both surfaces must be 32 bits per pixel with the same pixel format and
+ * dst must be the size of src after rotation.  Surfaces are expected to be
+ * locked by the caller if needed.
+ *
+ * @return the rect in dst that was written
+ */
+SDL_Rect rotate_blit(SDL_Surface* src, const SDL_Rect& rect,
+      SDL_Surface* dst, int angle);
+
+} // end namespace
+
+#endif
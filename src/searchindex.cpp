@@ -0,0 +1,130 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "searchindex.h"
+#include "log.h"
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+using namespace ll;
+using namespace std;
+
+/**
+ * Orders entries by the text that follows them, comparing only the first
+ * len characters when len isn't zero.
+ */
+struct cmp_text {
+   const char* text;
+   size_t len;
+
+   cmp_text(const char* text, size_t len = 0) : text(text), len(len) { }
+
+   int compare(const char* left, const char* right) const
+   { return len? strncmp(left, right, len) : strcmp(left, right); }
+};
+
+struct cmp_entry : cmp_text {
+   cmp_entry(const char* text) : cmp_text(text) { }
+
+   template <class E>
+   bool operator()(const E& left, const E& right) const
+   { return compare(text + left.offset, text + right.offset) < 0; }
+};
+
+/** True for entries before the query */
+struct before_query : cmp_text {
+   const char* query;
+   before_query(const char* text, const char* query) :
+      cmp_text(text, strlen(query)), query(query) { }
+
+   template <class E>
+   bool operator()(const E& e, const char*) const
+   { return compare(text + e.offset, query) < 0; }
+};
+
+/** True for the query against entries after it */
+struct after_query : cmp_text {
+   const char* query;
+   after_query(const char* text, const char* query) :
+      cmp_text(text, strlen(query)), query(query) { }
+
+   template <class E>
+   bool operator()(const char*, const E& e) const
+   { return compare(query, text + e.offset) < 0; }
+};
+
+search_index::search_index(const catalogue& games) :
+   _games(games.size())
+{
+   Uint32 start = SDL_GetTicks();
+
+   for (Uint32 g = 0; g < _games; g++) {
+      const char* name = games.name(g);
+      bool in_word = false;
+
+      for (const char* c = name; *c; c++) {
+         bool word_char = isalnum((unsigned char)*c) != 0;
+
+         // a word starts at each letter or digit following anything else
+         if (word_char && !in_word) {
+            entry e;
+            e.offset = _text.size() + (c - name);
+            e.game = g;
+            _words.push_back(e);
+         }
+
+         in_word = word_char;
+      }
+
+      for (const char* c = name; *c; c++)
+         _text.push_back(tolower((unsigned char)*c));
+      _text.push_back('\0');
+   }
+
+   sort(_words.begin(), _words.end(), cmp_entry(&_text[0]));
+
+   log << info << "search_index: " << _words.size() << " words in "
+       << SDL_GetTicks() - start << "ms" << endl;
+}
+
+size_t search_index::find(const string& query, vector<Uint8>& marks) const
+{
+   marks.assign(_games, 0);
+
+   if (_words.empty())
+      return 0;
+
+   string q(query);
+   for (string::iterator c = q.begin(); c != q.end(); c++)
+      *c = tolower((unsigned char)*c);
+
+   const char* text = &_text[0];
+
+   vector<entry>::const_iterator first = lower_bound(_words.begin(),
+         _words.end(), q.c_str(), before_query(text, q.c_str()));
+   vector<entry>::const_iterator last = upper_bound(first,
+         _words.end(), q.c_str(), after_query(text, q.c_str()));
+
+   for (vector<entry>::const_iterator i = first; i != last; i++)
+      marks[i->game] = 1;
+
+   return last - first;
+}
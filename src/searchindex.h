@@ -0,0 +1,66 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SEARCHINDEX_H_
+#define SEARCHINDEX_H_
+
+#include <SDL/SDL.h>
+#include <string>
+#include <vector>
+
+#include "catalogue.h"
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Prefix index over game names for type-ahead search.  Every word of every
+ * name is an entry, sorted by the (lower case) text from the start of the
+ * word to the end of the name.  The games whose names have a word starting
+ * with some text are then a single range of entries, found by binary
+ * search.  Queries may span words, "street fi" finds "Street Fighter".
+ */
+class search_index {
+private:
+   struct entry {
+      Uint32 offset; // start of the word in _text
+      Uint32 game;   // catalogue index of the game
+   };
+
+   vector<char> _text;    // lower case game names, nul terminated
+   vector<entry> _words;  // sorted by the text at their offset
+   Uint32 _games;         // number of games in the catalogue
+
+public:
+   /** Indexes the names of all games in the catalogue */
+   search_index(const catalogue& games);
+
+   /**
+    * Marks the games with a word starting with the query.
+    * @param query text to match, case is ignored
+    * @param marks set to one entry per game, non-zero for matches
+    * @return number of matching words
+    */
+   size_t find(const string& query, vector<Uint8>& marks) const;
+};
+
+} // end namespace
+
+#endif
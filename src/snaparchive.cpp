@@ -0,0 +1,447 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "snaparchive.h"
+#include "log.h"
+
+#include <cstdio>
+#include <vector>
+#include <zlib.h>
+
+/* zip record signatures */
+#define SIG_LOCAL_HEADER 0x04034b50
+#define SIG_CENTRAL_HEADER 0x02014b50
+#define SIG_END_OF_DIRECTORY 0x06054b50
+
+/* fixed sizes of zip records, not including names and extras */
+#define LOCAL_HEADER_SIZE 30
+#define CENTRAL_HEADER_SIZE 46
+#define END_OF_DIRECTORY_SIZE 22
+#define MAX_COMMENT_SIZE 0xffff
+
+#define METHOD_STORED 0
+#define METHOD_DEFLATED 8
+
+/* bytes of compressed data read from the archive at a time */
+#define INPUT_BUFFER_SIZE 16384
+
+using namespace ll;
+using namespace std;
+
+/**
+ * State of an open archive entry, kept in the hidden data of the SDL_RWops.
+ */
+struct zip_stream {
+   FILE* file;
+   long start;      // offset of the entry data in the archive
+   Uint32 size;     // compressed size
+   Uint32 length;   // uncompressed size
+   Uint16 method;
+
+   Uint32 pos;      // position in the uncompressed data
+   Uint32 consumed; // compressed bytes read from the archive
+   z_stream z;
+   Uint8 in[INPUT_BUFFER_SIZE];
+};
+
+static inline Uint16 get16(const Uint8* p)
+{ return p[0] | (p[1] << 8); }
+
+static inline Uint32 get32(const Uint8* p)
+{ return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24); }
+
+/**
+ * Inflates up to n bytes of an entry into dst, returns the number of bytes
+ * produced or -1 if the data is corrupt.
+ */
+static int zip_inflate(zip_stream* s, Uint8* dst, Uint32 n)
+{
+   s->z.next_out = dst;
+   s->z.avail_out = n;
+
+   while (s->z.avail_out > 0) {
+      if (s->z.avail_in == 0 && s->consumed < s->size) {
+         Uint32 want = s->size - s->consumed;
+         if (want > INPUT_BUFFER_SIZE) want = INPUT_BUFFER_SIZE;
+
+         size_t got = fread(s->in, 1, want, s->file);
+         if (got == 0)
+            return -1; // archive truncated
+
+         s->consumed += got;
+         s->z.next_in = s->in;
+         s->z.avail_in = got;
+      }
+
+      int rc = inflate(&s->z, Z_NO_FLUSH);
+
+      if (rc == Z_STREAM_END)
+         break;
+      if (rc != Z_OK)
+         return -1;
+   }
+
+   Uint32 produced = n - s->z.avail_out;
+   s->pos += produced;
+
+   return produced;
+}
+
+/**
+ * Rewinds an entry to the start of its data.
+ */
+static int zip_rewind(zip_stream* s)
+{
+   s->pos = 0;
+   s->consumed = 0;
+
+   if (fseek(s->file, s->start, SEEK_SET) != 0)
+      return -1;
+
+   if (s->method == METHOD_DEFLATED) {
+      s->z.avail_in = 0;
+      if (inflateReset(&s->z) != Z_OK)
+         return -1;
+   }
+
+   return 0;
+}
+
+static int zip_read(SDL_RWops* ctx, void* ptr, int size, int maxnum)
+{
+   zip_stream* s = (zip_stream*)ctx->hidden.unknown.data1;
+
+   if (size <= 0 || maxnum <= 0)
+      return 0;
+
+   Uint32 n = size * maxnum;
+   if (n > s->length - s->pos)
+      n = s->length - s->pos;
+
+   int got;
+
+   if (s->method == METHOD_STORED) {
+      if (fseek(s->file, s->start + s->pos, SEEK_SET) != 0)
+         return -1;
+
+      got = fread(ptr, 1, n, s->file);
+      s->pos += got;
+   } else {
+      got = zip_inflate(s, (Uint8*)ptr, n);
+   }
+
+   return got < 0? -1 : got / size;
+}
+
+static int zip_seek(SDL_RWops* ctx, int offset, int whence)
+{
+   zip_stream* s = (zip_stream*)ctx->hidden.unknown.data1;
+
+   long target;
+   switch (whence) {
+   case RW_SEEK_SET: target = offset; break;
+   case RW_SEEK_CUR: target = (long)s->pos + offset; break;
+   case RW_SEEK_END: target = (long)s->length + offset; break;
+   default: return -1;
+   }
+
+   if (target < 0 || target > (long)s->length)
+      return -1;
+
+   if (s->method == METHOD_STORED) {
+      s->pos = target;
+      return s->pos;
+   }
+
+   // deflate streams only go forward, start over to go back (image
+   // loaders only go back to the start after sniffing the file type)
+   if ((Uint32)target < s->pos && zip_rewind(s) != 0)
+      return -1;
+
+   Uint8 skip[1024];
+   while (s->pos < (Uint32)target) {
+      Uint32 n = target - s->pos;
+      if (n > sizeof(skip)) n = sizeof(skip);
+
+      if (zip_inflate(s, skip, n) <= 0)
+         return -1;
+   }
+
+   return s->pos;
+}
+
+static int zip_write(SDL_RWops*, const void*, int, int)
+{ return -1; }
+
+static int zip_close(SDL_RWops* ctx)
+{
+   if (ctx) {
+      zip_stream* s = (zip_stream*)ctx->hidden.unknown.data1;
+
+      if (s->method == METHOD_DEFLATED)
+         inflateEnd(&s->z);
+
+      fclose(s->file);
+      delete s;
+
+      SDL_FreeRW(ctx);
+   }
+
+   return 0;
+}
+
+snap_archive::snap_archive(const string& path) : _path(path)
+{
+   FILE* file = fopen(path.c_str(), "rb");
+
+   if (file == NULL) {
+      log << warn << "snap_archive: unable to open " << path << endl;
+      return;
+   }
+
+   if (!read_directory(file)) {
+      log << warn << "snap_archive: " << path << " is not a supported zip file"
+          << endl;
+      _index.clear();
+   }
+
+   fclose(file);
+
+   log << info << "snap_archive: " << _index.size() << " snapshots in "
+       << path << endl;
+}
+
+/** True if a name is a snapshot number like 0000.png */
+static bool numbered(const string& name)
+{
+   string::size_type dot = name.rfind('.');
+   if (dot == 0 || dot == string::npos)
+      return false;
+
+   for (string::size_type i = 0; i < dot; i++)
+      if (name[i] < '0' || name[i] > '9') return false;
+
+   return true;
+}
+
+/**
+ * Finds the rom of a snapshot named rom.png or rom/0000.png.
+ * @return false if the name isn't a snapshot
+ */
+static bool snap_rom(const string& name, string& rom)
+{
+   string::size_type slash = name.find('/');
+
+   if (slash == string::npos)
+      rom = name.substr(0, name.rfind('.'));
+   else if (name.find('/', slash+1) == string::npos &&
+         numbered(name.substr(slash+1)))
+      rom = name.substr(0, slash);
+   else
+      return false;
+
+   return !rom.empty();
+}
+
+string snap_archive::common_folder(const vector<entry>& entries)
+{
+   if (entries.empty())
+      return "";
+
+   string::size_type slash = entries[0].name.find('/');
+   if (slash == string::npos)
+      return "";
+
+   // the folder of rom/0000.png snapshots isn't a common folder, one holding
+   // rom.png snapshots or rom folders is
+   string folder = entries[0].name.substr(0, slash+1);
+   bool holds_roms = false;
+
+   for (vector<entry>::const_iterator e = entries.begin(); e != entries.end(); e++) {
+      if (e->name.compare(0, folder.size(), folder) != 0)
+         return "";
+
+      string rest = e->name.substr(folder.size());
+      holds_roms |= rest.find('/') != string::npos || !numbered(rest);
+   }
+
+   return holds_roms? folder : "";
+}
+
+bool snap_archive::read_directory(FILE* file)
+{
+   if (fseek(file, 0, SEEK_END) != 0)
+      return false;
+
+   long file_size = ftell(file);
+   if (file_size < END_OF_DIRECTORY_SIZE)
+      return false;
+
+   // end of directory record is last, followed only by the archive comment
+   long tail = END_OF_DIRECTORY_SIZE + MAX_COMMENT_SIZE;
+   if (tail > file_size) tail = file_size;
+
+   vector<Uint8> buf(tail);
+   if (fseek(file, file_size - tail, SEEK_SET) != 0 ||
+         fread(&buf[0], 1, tail, file) != (size_t)tail)
+      return false;
+
+   const Uint8* eod = NULL;
+   for (long i = tail - END_OF_DIRECTORY_SIZE; i >= 0 && !eod; i--) {
+      if (get32(&buf[i]) == SIG_END_OF_DIRECTORY)
+         eod = &buf[i];
+   }
+
+   if (!eod)
+      return false;
+
+   Uint32 dir_size = get32(eod + 12);
+   Uint32 dir_offset = get32(eod + 16);
+
+   // zip64 archives mark these as 0xffffffff, they are not supported
+   if (dir_offset == 0xffffffff || (long)dir_offset + dir_size > file_size)
+      return false;
+
+   vector<Uint8> dir(dir_size + 1);
+   if (fseek(file, dir_offset, SEEK_SET) != 0 ||
+         fread(&dir[0], 1, dir_size, file) != dir_size)
+      return false;
+
+   Uint32 pos = 0;
+   vector<entry> entries;
+
+   while (pos + CENTRAL_HEADER_SIZE <= dir_size) {
+      const Uint8* p = &dir[pos];
+      if (get32(p) != SIG_CENTRAL_HEADER)
+         break;
+
+      Uint16 name_len = get16(p + 28);
+      Uint32 record = CENTRAL_HEADER_SIZE + name_len + get16(p + 30) + get16(p + 32);
+
+      if (pos + record > dir_size)
+         break;
+
+      entry e;
+      e.name.assign((const char*)p + CENTRAL_HEADER_SIZE, name_len);
+      e.method = get16(p + 10);
+      e.dostime = get32(p + 12);
+      e.crc = get32(p + 16);
+      e.size = get32(p + 20);
+      e.length = get32(p + 24);
+      e.offset = get32(p + 42);
+
+      pos += record;
+
+      if (e.length > 0 && !e.name.empty() && e.name[e.name.size()-1] != '/' &&
+            (e.method == METHOD_STORED || e.method == METHOD_DEFLATED))
+         entries.push_back(e);
+   }
+
+   // archives made by zipping a snap folder have it in front of every name
+   string folder = common_folder(entries);
+
+   for (vector<entry>::iterator e = entries.begin(); e != entries.end(); e++) {
+      string rom;
+      if (!snap_rom(e->name.substr(folder.size()), rom))
+         continue;
+
+      // use the first snapshot of a rom, which sorts before the others
+      index_map::iterator found = _index.find(rom);
+      if (found == _index.end())
+         _index[rom] = *e;
+      else if (e->name < found->second.name)
+         found->second = *e;
+   }
+
+   return true;
+}
+
+bool snap_archive::find(const string& rom, Sint64& stamp) const
+{
+   index_map::const_iterator found = _index.find(rom);
+
+   if (found == _index.end())
+      return false;
+
+   stamp = ((Sint64)found->second.crc << 32) | found->second.dostime;
+   return true;
+}
+
+SDL_RWops* snap_archive::open(const string& rom) const
+{
+   index_map::const_iterator found = _index.find(rom);
+   if (found == _index.end())
+      return NULL;
+
+   const entry& e = found->second;
+
+   // every stream has its own file so loader threads don't share a position
+   FILE* file = fopen(_path.c_str(), "rb");
+   if (file == NULL)
+      return NULL;
+
+   // local header has its own extra field length, data follows it
+   Uint8 header[LOCAL_HEADER_SIZE];
+   if (fseek(file, e.offset, SEEK_SET) != 0 ||
+         fread(header, 1, LOCAL_HEADER_SIZE, file) != LOCAL_HEADER_SIZE ||
+         get32(header) != SIG_LOCAL_HEADER) {
+      fclose(file);
+      return NULL;
+   }
+
+   zip_stream* s = new zip_stream;
+   s->file = file;
+   s->start = e.offset + LOCAL_HEADER_SIZE + get16(header + 26) + get16(header + 28);
+   s->size = e.size;
+   s->length = e.length;
+   s->method = e.method;
+
+   s->z.zalloc = Z_NULL;
+   s->z.zfree = Z_NULL;
+   s->z.opaque = Z_NULL;
+   s->z.next_in = Z_NULL;
+   s->z.avail_in = 0;
+
+   // negative window bits, zip entries are raw deflate without a header
+   if (s->method == METHOD_DEFLATED && inflateInit2(&s->z, -MAX_WBITS) != Z_OK) {
+      fclose(file);
+      delete s;
+      return NULL;
+   }
+
+   SDL_RWops* ctx = SDL_AllocRW();
+   if (ctx == NULL || zip_rewind(s) != 0) {
+      if (s->method == METHOD_DEFLATED)
+         inflateEnd(&s->z);
+      fclose(file);
+      delete s;
+
+      if (ctx)
+         SDL_FreeRW(ctx);
+      return NULL;
+   }
+
+   ctx->seek = zip_seek;
+   ctx->read = zip_read;
+   ctx->write = zip_write;
+   ctx->close = zip_close;
+   ctx->hidden.unknown.data1 = s;
+
+   return ctx;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SNAPARCHIVE_H_
+#define SNAPARCHIVE_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_rwops.h>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Snapshots packed in a zip archive such as MAME's snap.zip.  The central
+ * directory is read once when the archive is opened; entries named either
+ * "rom.png" or "rom/0000.png" are indexed by rom name, also when the whole
+ * archive is inside one folder such as "snap/".  Entries are read
+ * through an SDL_RWops that inflates as the image is decoded, nothing is
+ * extracted to disk.
+ *
+ * The index is never changed after construction, so all methods are safe
+ * to call from several threads.
+ */
+class snap_archive {
+private:
+   struct entry {
+      string name;      // name of the entry in the archive
+      Uint32 offset;    // offset of the local file header
+      Uint32 size;      // compressed size
+      Uint32 length;    // uncompressed size
+      Uint16 method;    // 0 stored, 8 deflated
+      Uint32 crc;
+      Uint32 dostime;   // modification date and time in dos format
+   };
+
+   typedef map<string, entry> index_map;
+
+   string _path;
+   index_map _index;
+
+   /** Reads the central directory into the index */
+   bool read_directory(FILE* file);
+
+   /**
+    * Returns the folder every entry is in, with a trailing slash, or an
+    * empty string if there isn't one (other than the folder of a rom)
+    */
+   static string common_folder(const vector<entry>& entries);
+
+public:
+   /**
+    * Opens an archive and reads its central directory.  Errors are logged
+    * and leave the archive empty.
+    */
+   snap_archive(const string& path);
+
+   /** Returns the number of snapshots in the archive */
+   size_t size() const
+   { return _index.size(); }
+
+   /**
+    * Looks up the snapshot of a rom.
+    * @param stamp set to a value that changes when the entry is replaced
+    * @return false if the archive has no snapshot for the rom
+    */
+   bool find(const string& rom, Sint64& stamp) const;
+
+   /**
+    * Opens the snapshot of a rom for reading.  Nothing is logged so this
+    * can be called from loader threads.
+    * @return stream to be closed with SDL_RWclose, or NULL on error
+    */
+   SDL_RWops* open(const string& rom) const;
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "snapcache.h"
+
+/* bytes charged for entries without a snapshot, for the lookup overhead */
+#define EMPTY_ENTRY_BYTES 64
+
+using namespace ll;
+using namespace std;
+
+snap_cache::snap_cache(size_t budget) :
+   _budget(budget), _bytes(0), _hits(0), _misses(0), _evictions(0) { }
+
+snap_cache::~snap_cache()
+{
+   log_stats(info);
+
+   for (lru_list::iterator i = _lru.begin(); i != _lru.end(); i++) {
+      if (i->surface)
+         SDL_FreeSurface(i->surface);
+   }
+}
+
+bool snap_cache::get(const string& rom, SDL_Surface*& surface)
+{
+   lookup_map::iterator found = _lookup.find(rom);
+
+   if (found == _lookup.end()) {
+      if (rom != _last_miss) {
+         _misses++;
+         _last_miss = rom;
+      }
+      return false;
+   }
+
+   // move entry to the front of the list, it's now most recently used
+   _lru.splice(_lru.begin(), _lru, found->second);
+   surface = found->second->surface;
+   _hits++;
+   _last_miss.clear();
+
+   return true;
+}
+
+void snap_cache::touch(const string& rom)
+{
+   lookup_map::iterator found = _lookup.find(rom);
+
+   if (found != _lookup.end())
+      _lru.splice(_lru.begin(), _lru, found->second);
+}
+
+void snap_cache::put(const string& rom, SDL_Surface* surface)
+{
+   remove(rom);
+
+   entry e;
+   e.rom = rom;
+   e.surface = surface;
+   e.bytes = surface? surface->pitch * surface->h : EMPTY_ENTRY_BYTES;
+
+   _lru.push_front(e);
+   _lookup[rom] = _lru.begin();
+   _bytes += e.bytes;
+
+   evict();
+}
+
+void snap_cache::remove(const string& rom)
+{
+   lookup_map::iterator found = _lookup.find(rom);
+
+   if (found != _lookup.end()) {
+      entry& e = *found->second;
+
+      _bytes -= e.bytes;
+      if (e.surface)
+         SDL_FreeSurface(e.surface);
+
+      _lru.erase(found->second);
+      _lookup.erase(found);
+   }
+}
+
+void snap_cache::evict()
+{
+   // never evict the most recent entry, it's about to be shown
+   while (_bytes > _budget && _lru.size() > 1) {
+      entry& e = _lru.back();
+
+      _bytes -= e.bytes;
+      _lookup.erase(e.rom);
+
+      // surfaces still being displayed are kept alive by their refcount
+      if (e.surface)
+         SDL_FreeSurface(e.surface);
+
+      _lru.pop_back();
+      _evictions++;
+   }
+}
+
+void snap_cache::log_stats(log_level level) const
+{
+   log << level << "snap_cache: " << _lru.size() << " entries, "
+       << _bytes / 1024 << "k of " << _budget / 1024 << "k, hits=" << _hits
+       << " misses=" << _misses << " evictions=" << _evictions << endl;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SNAPCACHE_H_
+#define SNAPCACHE_H_
+
+#include <SDL/SDL.h>
+#include <string>
+#include <list>
+#include <map>
+
+#include "log.h"
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Cache of prepared snapshot surfaces keyed by rom name.  Roms without a
+ * snapshot are cached too (as NULL) so they aren't looked up again.  When
+ * the cache grows past its memory budget the least recently used
+ * snapshots are released.
+ *
+ * The cache is only used from the ui thread so it does no locking.
+ */
+class snap_cache {
+private:
+   struct entry {
+      string rom;
+      SDL_Surface* surface;
+      size_t bytes;
+   };
+
+   typedef list<entry> lru_list;
+   typedef map<string, lru_list::iterator> lookup_map;
+
+   lru_list _lru;      // most recently used at the front
+   lookup_map _lookup;
+
+   size_t _budget; // maximum number of bytes held by cached surfaces
+   size_t _bytes;  // number of bytes currently held
+
+   unsigned long _hits;
+   unsigned long _misses;
+   unsigned long _evictions;
+   string _last_miss; // rom of the last miss, looked up again while loading
+
+   /** Releases least recently used snapshots until within budget */
+   void evict();
+
+public:
+   /** Creates a cache that holds at most budget bytes of surfaces */
+   snap_cache(size_t budget);
+
+   /** Releases all cached snapshots */
+   ~snap_cache();
+
+   /**
+    * Looks up a snapshot and counts the lookup as a hit or miss.  Looking
+    * up the same rom again, while waiting for it to load, isn't counted as
+    * another miss.  The surface is owned by the cache, take a reference if
+    * it's kept.
+    * @return true if the rom is cached, surface is NULL when the rom has
+    * no snapshot
+    */
+   bool get(const string& rom, SDL_Surface*& surface);
+
+   /** Returns true if the rom is cached, without counting a hit or miss */
+   bool contains(const string& rom) const
+   { return _lookup.find(rom) != _lookup.end(); }
+
+   /** Makes a cached rom the most recently used, without counting a hit */
+   void touch(const string& rom);
+
+   /**
+    * Adds the snapshot of a rom, replacing any cached one.  The cache takes
+    * ownership of the surface, which may be NULL.
+    */
+   void put(const string& rom, SDL_Surface* surface);
+
+   /** Drops the snapshot of a rom, so it's loaded again */
+   void remove(const string& rom);
+
+   /** Writes the hit/miss/eviction counters to the log */
+   void log_stats(log_level level = debug) const;
+};
+
+} // end namespace
+
+#endif
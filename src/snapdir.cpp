@@ -0,0 +1,295 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "snapdir.h"
+#include "options.h"
+#include "log.h"
+
+#include <cstring>
+#include <algorithm>
+#include <strings.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+
+/* milliseconds the watcher waits for changes before checking for quit */
+#define WATCH_TIMEOUT 250
+
+using namespace ll;
+using namespace std;
+
+/* image extensions looked for besides the one in the snap option */
+static const char* extensions[] = { ".png", ".jpg", ".jpeg", NULL };
+
+snap_dir::snap_dir() :
+   _pattern(g_opts.get_string(KEY_MAME_SNAP_PATH)), _scanned(false),
+   _watcher(NULL), _notify_fd(-1), _quit(false)
+{
+   _lock = SDL_CreateMutex();
+
+   string::size_type pos = _pattern.find("%r");
+
+   // %r must be in the file name for the directory to be scanned
+   if (pos == string::npos || _pattern.find('/', pos) != string::npos)
+      return;
+
+   string::size_type slash = _pattern.rfind('/', pos);
+   if (slash == string::npos) {
+      _dir = ".";
+      _prefix = _pattern.substr(0, pos);
+   } else {
+      _dir = slash == 0? "/" : _pattern.substr(0, slash);
+      _prefix = _pattern.substr(slash + 1, pos - slash - 1);
+   }
+
+   string rest = _pattern.substr(pos + 2);
+   string::size_type dot = rest.rfind('.');
+   _suffix = rest.substr(0, dot);
+   if (dot != string::npos)
+      _ext = rest.substr(dot);
+
+   Uint32 start = SDL_GetTicks();
+
+   if (!scan()) {
+      log << warn << "snap_dir: unable to read " << _dir << endl;
+      return;
+   }
+
+   _scanned = true;
+
+   log << info << "snap_dir: " << _files.size() << " snapshots in " << _dir
+       << " (" << SDL_GetTicks() - start << "ms)" << endl;
+
+#ifdef HAVE_SYS_INOTIFY_H
+   _notify_fd = inotify_init();
+
+   if (_notify_fd != -1 && inotify_add_watch(_notify_fd, _dir.c_str(),
+         IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) != -1)
+      _watcher = SDL_CreateThread(&snap_dir::watcher, this);
+
+   if (!_watcher)
+      log << warn << "snap_dir: unable to watch " << _dir << " for changes" << endl;
+#endif
+}
+
+snap_dir::~snap_dir()
+{
+   if (_watcher) {
+      SDL_mutexP(_lock);
+      _quit = true;
+      SDL_mutexV(_lock);
+
+      SDL_WaitThread(_watcher, NULL);
+   }
+
+   if (_notify_fd != -1)
+      close(_notify_fd);
+
+   SDL_DestroyMutex(_lock);
+}
+
+bool snap_dir::match(const char* file, string& rom, int& rank) const
+{
+   string name(file);
+
+   if (name.compare(0, _prefix.length(), _prefix) != 0)
+      return false;
+
+   string::size_type dot = _ext.empty()? string::npos : name.rfind('.');
+   if (dot != string::npos && dot < _prefix.length())
+      return false;
+
+   string base = name.substr(_prefix.length(), dot - _prefix.length());
+   string ext = dot == string::npos? "" : name.substr(dot);
+
+   if (base.length() <= _suffix.length() ||
+         base.compare(base.length() - _suffix.length(), _suffix.length(), _suffix) != 0)
+      return false;
+
+   if (ext == _ext) {
+      rank = 0;
+   } else if (strcasecmp(ext.c_str(), _ext.c_str()) == 0) {
+      rank = 1;
+   } else {
+      rank = -1;
+      for (int i = 0; extensions[i] && rank == -1; i++) {
+         if (strcasecmp(ext.c_str(), extensions[i]) == 0)
+            rank = 2 + i;
+      }
+
+      if (rank == -1)
+         return false;
+   }
+
+   rom = base.substr(0, base.length() - _suffix.length());
+   return true;
+}
+
+bool snap_dir::scan()
+{
+   DIR* dir = opendir(_dir.c_str());
+   if (dir == NULL)
+      return false;
+
+   map<string, int> ranks;
+   struct dirent* ent;
+
+   while ((ent = readdir(dir)) != NULL) {
+      string rom;
+      int rank;
+
+      if (!match(ent->d_name, rom, rank))
+         continue;
+
+      // keep the best match when a rom has several images
+      map<string, int>::iterator found = ranks.find(rom);
+      if (found == ranks.end() || rank < found->second) {
+         ranks[rom] = rank;
+         _files[rom] = ent->d_name;
+      }
+   }
+
+   closedir(dir);
+   return true;
+}
+
+void snap_dir::refresh(const string& rom)
+{
+   string base(_prefix + rom + _suffix);
+   string file;
+
+   // same preference as the scan, except for odd cased extensions
+   if (access((_dir + '/' + base + _ext).c_str(), R_OK) == 0) {
+      file = base + _ext;
+   } else {
+      for (const char** e = extensions; *e && file.empty(); e++) {
+         if (access((_dir + '/' + base + *e).c_str(), R_OK) == 0)
+            file = base + *e;
+      }
+   }
+
+   SDL_mutexP(_lock);
+
+   if (file.empty())
+      _files.erase(rom);
+   else
+      _files[rom] = file;
+
+   if (find(_changed.begin(), _changed.end(), rom) == _changed.end())
+      _changed.push_back(rom);
+
+   SDL_mutexV(_lock);
+}
+
+bool snap_dir::resolve(const string& rom, string& path) const
+{
+   if (!_scanned) {
+      // missing %r specifier is reported once by the snapshot loader
+      string::size_type pos = _pattern.find("%r");
+      if (pos == string::npos)
+         return false;
+
+      path.assign(_pattern).replace(pos, 2, rom);
+      return true;
+   }
+
+   SDL_mutexP(_lock);
+
+   map<string, string>::const_iterator found = _files.find(rom);
+   bool exists = found != _files.end();
+   if (exists)
+      path.assign(_dir + '/' + found->second);
+
+   SDL_mutexV(_lock);
+
+   return exists;
+}
+
+bool snap_dir::take_changed(string& rom)
+{
+   SDL_mutexP(_lock);
+
+   bool found = !_changed.empty();
+   if (found) {
+      rom = _changed.back();
+      _changed.pop_back();
+   }
+
+   SDL_mutexV(_lock);
+
+   return found;
+}
+
+void snap_dir::watch()
+{
+#ifdef HAVE_SYS_INOTIFY_H
+   // aligned for the inotify_event structs read into it
+   Uint32 buf[1024];
+
+   struct pollfd pfd;
+   pfd.fd = _notify_fd;
+   pfd.events = POLLIN;
+
+   for (;;) {
+      SDL_mutexP(_lock);
+      bool quit = _quit;
+      SDL_mutexV(_lock);
+
+      if (quit)
+         break;
+
+      if (poll(&pfd, 1, WATCH_TIMEOUT) <= 0)
+         continue;
+
+      ssize_t len = read(_notify_fd, buf, sizeof(buf));
+      bool changed = false;
+
+      for (ssize_t pos = 0; pos < len; ) {
+         const inotify_event* ev = (const inotify_event*)((char*)buf + pos);
+         pos += sizeof(inotify_event) + ev->len;
+
+         string rom;
+         int rank;
+
+         if (ev->len && match(ev->name, rom, rank)) {
+            refresh(rom);
+            changed = true;
+         }
+      }
+
+      if (changed) {
+         SDL_Event evt;
+         evt.type = SDL_USEREVENT;
+         evt.user.code = SNAP_CHANGED_EVENT;
+         SDL_PushEvent(&evt);
+      }
+   }
+#endif
+}
+
+int snap_dir::watcher(void* data)
+{
+   ((snap_dir*)data)->watch();
+   return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SNAPDIR_H_
+#define SNAPDIR_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/* user event code pushed when snapshot files are added or removed */
+#define SNAP_CHANGED_EVENT 3
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Knows which roms have a snapshot file in the snap directory, so roms
+ * without one are never looked for on disk.  The directory is read once
+ * when created; files named like the snap option, with a png, jpg or jpeg
+ * extension, are recorded by rom name.
+ *
+ * Where inotify is available a thread watches the directory, updates the
+ * record and pushes a SNAP_CHANGED_EVENT user event when files come and
+ * go.  The changed roms are collected with take_changed().
+ *
+ * When the snap option can't be matched against a single directory (for
+ * example %r names a directory) every rom is assumed to have a snapshot.
+ */
+class snap_dir {
+private:
+   string _pattern; // snap option, %r is replaced with the rom name
+   string _dir;     // directory holding the snapshots
+   string _prefix;  // file name before %r
+   string _suffix;  // file name after %r, without the extension
+   string _ext;     // extension of the snap option, with the dot
+   bool _scanned;   // false if the directory couldn't be read
+
+   SDL_mutex* _lock;
+   map<string, string> _files;  // rom name to snapshot file name
+   vector<string> _changed;     // roms changed since last take_changed
+
+   SDL_Thread* _watcher;
+   int _notify_fd;
+   bool _quit;
+
+   /**
+    * Matches a file name against the snap option.
+    * @param rank lower for better matches, the snap option's own extension
+    * is best
+    * @return false if the file isn't a snapshot
+    */
+   bool match(const char* file, string& rom, int& rank) const;
+
+   /** Reads the directory, returns false if it couldn't be read */
+   bool scan();
+
+   /** Looks for the snapshot of a single rom again */
+   void refresh(const string& rom);
+
+   /** Watcher thread main loop */
+   void watch();
+
+   /** Thread entry point, data is the snap_dir */
+   static int watcher(void* data);
+
+public:
+   /** Reads the snap directory and starts watching it */
+   snap_dir();
+
+   /** Stops watching the directory */
+   ~snap_dir();
+
+   /**
+    * Finds the snapshot file of a rom without touching the disk.
+    * @return false if the rom is known to have no snapshot
+    */
+   bool resolve(const string& rom, string& path) const;
+
+   /**
+    * Takes the next rom whose snapshot was added, replaced or removed.
+    * @return false if nothing changed
+    */
+   bool take_changed(string& rom);
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "snaploader.h"
+#include "options.h"
+#include "error.h"
+#include "log.h"
+
+#include <SDL/SDL_image.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <cstring>
+
+using namespace ll;
+using namespace std;
+
+snap_loader::snap_loader(const lemonui* ui, int threads) :
+   _ui(ui), _store(NULL), _archive(NULL), _dir(NULL), _quit(false)
+{
+   const char* archive = g_opts.get_string(KEY_SNAP_ARCHIVE);
+
+   if (*archive) {
+      _archive = new snap_archive(archive);
+   } else {
+      if (strstr(g_opts.get_string(KEY_MAME_SNAP_PATH), "%r") == NULL)
+         log << warn << "snap_loader: snap option missing %r specifier" << endl;
+
+      _dir = new snap_dir();
+   }
+
+   if (g_opts.get_bool(KEY_THUMBNAIL_CACHE)) {
+      string key;
+      Uint32 rmask, gmask, bmask;
+
+      ui->snap_format(key);
+      ui->snap_masks(rmask, gmask, bmask);
+
+      const SDL_Rect& rect = ui->snap_rect();
+      _store = new thumb_store(rect.w, rect.h, key, rmask, gmask, bmask);
+   }
+
+   _lock = SDL_CreateMutex();
+   _wake = SDL_CreateCond();
+
+   if (!_lock || !_wake)
+      throw bad_lemon("snap_loader: unable to create mutex");
+
+   if (threads < 1) threads = 1;
+
+   for (int i = 0; i < threads; i++) {
+      SDL_Thread* t = SDL_CreateThread(&snap_loader::worker, this);
+      if (t)
+         _workers.push_back(t);
+   }
+
+   if (_workers.empty())
+      throw bad_lemon("snap_loader: unable to start worker threads");
+
+   log << info << "snap_loader: started " << _workers.size()
+       << " worker threads" << endl;
+}
+
+snap_loader::~snap_loader()
+{
+   SDL_mutexP(_lock);
+   _quit = true;
+   _queue.clear();
+   _queued.clear();
+   SDL_CondBroadcast(_wake);
+   SDL_mutexV(_lock);
+
+   // workers finish the snapshot they are loading before exiting
+   for (vector<SDL_Thread*>::iterator i = _workers.begin(); i != _workers.end(); i++)
+      SDL_WaitThread(*i, NULL);
+
+   while (!_done.empty()) {
+      if (_done.front().second)
+         SDL_FreeSurface(_done.front().second);
+      _done.pop_front();
+   }
+
+   delete _store;
+   delete _archive;
+   delete _dir;
+
+   SDL_DestroyCond(_wake);
+   SDL_DestroyMutex(_lock);
+}
+
+void snap_loader::request(const vector<string>& roms)
+{
+   SDL_mutexP(_lock);
+
+   _queue.clear();
+   _queued.clear();
+
+   for (vector<string>::const_iterator i = roms.begin(); i != roms.end(); i++) {
+      if (_loading.find(*i) != _loading.end() || _finished.find(*i) != _finished.end())
+         continue; // already loading, or loaded and not yet taken
+
+      if (_queued.insert(*i).second)
+         _queue.push_back(*i);
+   }
+
+   if (!_queue.empty())
+      SDL_CondBroadcast(_wake);
+
+   SDL_mutexV(_lock);
+}
+
+bool snap_loader::pending(const string& rom)
+{
+   SDL_mutexP(_lock);
+
+   bool found = _queued.find(rom) != _queued.end() ||
+      _loading.find(rom) != _loading.end() ||
+      _finished.find(rom) != _finished.end();
+
+   SDL_mutexV(_lock);
+
+   return found;
+}
+
+bool snap_loader::take(string& rom, SDL_Surface*& surface)
+{
+   SDL_mutexP(_lock);
+
+   bool found = !_done.empty();
+   if (found) {
+      rom = _done.front().first;
+      surface = _done.front().second;
+      _done.pop_front();
+      _finished.erase(rom);
+   }
+
+   SDL_mutexV(_lock);
+
+   return found;
+}
+
+/**
+ * Returns a stamp that changes whenever a snapshot file is replaced, even
+ * twice in the same second
+ */
+static Sint64 file_stamp(const struct stat& st)
+{
+   Sint64 stamp = (Sint64)st.st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+   stamp += st.st_mtim.tv_nsec;
+#endif
+
+   // without nanoseconds a replacement usually still differs in size
+   return stamp ^ ((Sint64)st.st_size << 32);
+}
+
+SDL_Surface* snap_loader::load(const string& rom) const
+{
+   string path;
+   Sint64 stamp = 0;
+
+   // locate the image, the stamp changes whenever the image does so stale
+   // copies in the thumbnail store are never used
+   if (_archive) {
+      if (!_archive->find(rom, stamp))
+         return NULL;
+   } else {
+      // roms known to have no snapshot file are never looked for
+      if (!_dir->resolve(rom, path))
+         return NULL;
+
+      if (_store) {
+         struct stat st;
+         if (stat(path.c_str(), &st) != 0)
+            return NULL;
+         stamp = file_stamp(st);
+      }
+   }
+
+   if (_store) {
+      SDL_Surface* stored = _store->find(rom, stamp);
+      if (stored)
+         return stored;
+   }
+
+   SDL_Surface* raw;
+   if (_archive) {
+      SDL_RWops* src = _archive->open(rom);
+      raw = src? IMG_Load_RW(src, 1) : NULL;
+   } else {
+      raw = IMG_Load(path.c_str());
+   }
+
+   if (!raw)
+      return NULL;
+
+   // scale, fade and convert here so the ui thread only has to blit
+   SDL_Surface* prepared = _ui->prepare_snap(raw);
+
+   if (prepared && _store)
+      _store->add(rom, stamp, prepared);
+
+   return prepared;
+}
+
+void snap_loader::run()
+{
+   SDL_mutexP(_lock);
+
+   while (!_quit) {
+      if (_queue.empty()) {
+         SDL_CondWait(_wake, _lock);
+         continue;
+      }
+
+      string rom = _queue.front();
+      _queue.pop_front();
+      _queued.erase(rom);
+      _loading.insert(rom);
+
+      // decode without holding the lock
+      SDL_mutexV(_lock);
+      SDL_Surface* surface = load(rom);
+      SDL_mutexP(_lock);
+
+      _loading.erase(rom);
+      _done.push_back(make_pair(rom, surface));
+      _finished.insert(rom);
+
+      SDL_Event evt;
+      evt.type = SDL_USEREVENT;
+      evt.user.code = SNAP_LOADED_EVENT;
+      SDL_PushEvent(&evt);
+   }
+
+   SDL_mutexV(_lock);
+}
+
+int snap_loader::worker(void* data)
+{
+   ((snap_loader*)data)->run();
+   return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SNAPLOADER_H_
+#define SNAPLOADER_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+
+#include "lemonui.h"
+#include "thumbstore.h"
+#include "snaparchive.h"
+#include "snapdir.h"
+
+/* user event code pushed each time a snapshot finishes loading */
+#define SNAP_LOADED_EVENT 2
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Decodes and prepares snapshots on a small pool of worker threads so the
+ * interface never waits on disk or image decoding.  The owner requests the
+ * snapshots it wants, most important first, and a SNAP_LOADED_EVENT user
+ * event is pushed each time one finishes.  Finished snapshots are collected
+ * with take().
+ */
+class snap_loader {
+private:
+   const lemonui* _ui; // prepares the decoded snapshots for display
+   thumb_store* _store; // prepared snapshots kept on disk, NULL if disabled
+   snap_archive* _archive; // zip the snapshots are read from, NULL if none
+   snap_dir* _dir;         // snapshot files on disk, NULL if using the zip
+
+   vector<SDL_Thread*> _workers;
+   SDL_mutex* _lock;
+   SDL_cond* _wake;
+   bool _quit;
+
+   deque<string> _queue;   // roms waiting to be loaded
+   set<string> _queued;    // the roms in _queue, for quick lookup
+   set<string> _loading;   // roms being loaded by a worker
+   set<string> _finished;  // the roms in _done, for quick lookup
+
+   /* loaded snapshots that haven't been taken yet, NULL if none */
+   typedef deque< pair<string, SDL_Surface*> > done_list;
+   done_list _done;
+
+   /** Loads and prepares the snapshot of a rom */
+   SDL_Surface* load(const string& rom) const;
+
+   /** Worker thread main loop */
+   void run();
+
+   /** Thread entry point, data is the loader */
+   static int worker(void* data);
+
+public:
+   /** Starts the worker threads */
+   snap_loader(const lemonui* ui, int threads);
+
+   /**
+    * Stops the worker threads and frees loaded snapshots.  Snapshots from
+    * the thumbnail store point into its mapping, all surfaces taken from the
+    * loader must be freed before it is deleted.
+    */
+   ~snap_loader();
+
+   /**
+    * Replaces the queue of wanted snapshots.  Roms are loaded in the order
+    * given.  Roms being loaded already are not loaded again.
+    */
+   void request(const vector<string>& roms);
+
+   /**
+    * Returns true if the rom is queued, being loaded, or loaded and waiting
+    * to be taken.
+    */
+   bool pending(const string& rom);
+
+   /**
+    * Takes the next finished snapshot.  Ownership of the surface passes to
+    * the caller.
+    * @return false if no snapshot has finished, surface is NULL when the
+    * rom has no snapshot
+    */
+   bool take(string& rom, SDL_Surface*& surface);
+   
+   /**
+    * Takes the next rom whose snapshot file was added, replaced or removed
+    * since the SNAP_CHANGED_EVENT.
+    * @return false if nothing changed
+    */
+   bool take_changed(string& rom)
+   { return _dir? _dir->take_changed(rom) : false; }
+
+   /** Returns the number of snapshots in the thumbnail store */
+   size_t stored() const
+   { return _store? _store->size() : 0; }
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "stringpool.h"
+
+#include <cstring>
+
+/* marks an unused slot of the hash table */
+#define EMPTY_SLOT 0xffffffff
+
+/* initial number of hash table slots, must be a power of two */
+#define INITIAL_SLOTS 1024
+
+using namespace ll;
+using namespace std;
+
+/** FNV-1a hash of a nul terminated string */
+static Uint32 hash_string(const char* str)
+{
+   Uint32 h = 2166136261u;
+   for (; *str; str++)
+      h = (h ^ (Uint8)*str) * 16777619u;
+   return h;
+}
+
+string_pool::string_pool() :
+   _table(INITIAL_SLOTS, EMPTY_SLOT), _count(0)
+{
+   intern("");
+}
+
+Uint32 string_pool::slot(const char* str, Uint32 hash) const
+{
+   Uint32 mask = _table.size() - 1;
+   Uint32 i = hash & mask;
+
+   // linear probing, the table is never more than half full
+   while (_table[i] != EMPTY_SLOT && strcmp(&_data[_table[i]], str) != 0)
+      i = (i + 1) & mask;
+
+   return i;
+}
+
+Uint32 string_pool::intern(const char* str)
+{
+   Uint32 i = slot(str, hash_string(str));
+
+   if (_table[i] != EMPTY_SLOT)
+      return _table[i];
+
+   Uint32 offset = _data.size();
+   _data.insert(_data.end(), str, str + strlen(str) + 1);
+
+   _table[i] = offset;
+   if (++_count * 2 > _table.size())
+      grow();
+
+   return offset;
+}
+
+bool string_pool::find(const char* str, Uint32& offset) const
+{
+   Uint32 i = slot(str, hash_string(str));
+   if (_table[i] == EMPTY_SLOT)
+      return false;
+
+   offset = _table[i];
+   return true;
+}
+
+void string_pool::grow()
+{
+   vector<Uint32> old(_table.size() * 2, EMPTY_SLOT);
+   old.swap(_table);
+
+   for (vector<Uint32>::iterator i = old.begin(); i != old.end(); i++) {
+      if (*i != EMPTY_SLOT) {
+         const char* str = &_data[*i];
+         _table[slot(str, hash_string(str))] = *i;
+      }
+   }
+}
+
+void string_pool::compact()
+{
+   vector<char>(_data).swap(_data);
+}
+
+bool string_pool::restore(const char* data, Uint32 size, const Uint32* table,
+      Uint32 slots, Uint32 count)
+{
+   // strings must be terminated, the table a half full power of two
+   if (size == 0 || data[size-1] != '\0' || data[0] != '\0' ||
+         slots == 0 || (slots & (slots - 1)) != 0 || count * 2 > slots)
+      return false;
+
+   for (Uint32 i = 0; i < slots; i++)
+      if (table[i] != EMPTY_SLOT && table[i] >= size)
+         return false;
+
+   _data.assign(data, data + size);
+   _table.assign(table, table + slots);
+   _count = count;
+
+   return true;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef STRINGPOOL_H_
+#define STRINGPOOL_H_
+
+#include <SDL/SDL.h>
+#include <vector>
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Arena of nul terminated strings referred to by their offset.  Each
+ * distinct string is stored once, so repeated values like genres and
+ * parameters cost four bytes per use.  Offset 0 is the empty string.
+ *
+ * Pointers returned by get() are invalidated by intern(), keep offsets
+ * while the pool is still being filled.
+ */
+class string_pool {
+private:
+   vector<char> _data;    // the strings, back to back
+   vector<Uint32> _table; // open addressed hash table of offsets
+   Uint32 _count;         // number of distinct strings
+
+   /** Doubles the hash table and reinserts all strings */
+   void grow();
+
+   /** Returns the table slot holding str, or the empty slot it belongs in */
+   Uint32 slot(const char* str, Uint32 hash) const;
+
+public:
+   string_pool();
+
+   /** Returns the offset of the string, adding it if it isn't pooled yet */
+   Uint32 intern(const char* str);
+
+   /**
+    * Looks up the offset of a string without adding it.
+    * @return false if the string isn't pooled
+    */
+   bool find(const char* str, Uint32& offset) const;
+
+   /** Returns the string at the offset */
+   const char* get(Uint32 offset) const
+   { return &_data[offset]; }
+
+   /** Returns the number of bytes used by the pool */
+   size_t bytes() const
+   { return _data.capacity() + _table.capacity() * sizeof(Uint32); }
+
+   /** Releases memory reserved for strings that were never added */
+   void compact();
+
+   /** Returns the strings, back to back, for saving the pool */
+   const vector<char>& data() const
+   { return _data; }
+
+   /** Returns the hash table, for saving the pool */
+   const vector<Uint32>& table() const
+   { return _table; }
+
+   /** Returns the number of distinct strings */
+   Uint32 count() const
+   { return _count; }
+
+   /**
+    * Replaces the pool with one that was saved.
+    * @return false if the saved pool isn't consistent
+    */
+   bool restore(const char* data, Uint32 size, const Uint32* table,
+         Uint32 slots, Uint32 count);
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "textcache.h"
+
+using namespace ll;
+using namespace std;
+
+text_cache::text_cache(size_t budget) :
+   _budget(budget), _bytes(0) { }
+
+text_cache::~text_cache()
+{ clear(); }
+
+SDL_Surface* text_cache::render(TTF_Font* font, const char* text, SDL_Color color)
+{
+   key k;
+   k.text.assign(text);
+   k.font = font;
+   k.color = ((Uint32)color.r << 16) | ((Uint32)color.g << 8) | color.b;
+
+   lookup_map::iterator found = _lookup.find(k);
+   if (found != _lookup.end()) {
+      // move entry to the front of the list, it's now most recently used
+      _lru.splice(_lru.begin(), _lru, found->second);
+      return found->second->surface;
+   }
+
+   SDL_Surface* surface = TTF_RenderText_Blended(font, text, color);
+   if (surface == NULL)
+      return NULL;
+
+   entry e;
+   e.k = k;
+   e.surface = surface;
+   e.bytes = surface->pitch * surface->h;
+
+   _lru.push_front(e);
+   _lookup[k] = _lru.begin();
+   _bytes += e.bytes;
+
+   evict();
+
+   return surface;
+}
+
+void text_cache::evict()
+{
+   // never evict the most recent entry, it's about to be drawn
+   while (_bytes > _budget && _lru.size() > 1) {
+      entry& e = _lru.back();
+
+      _bytes -= e.bytes;
+      _lookup.erase(e.k);
+      SDL_FreeSurface(e.surface);
+
+      _lru.pop_back();
+   }
+}
+
+void text_cache::clear()
+{
+   for (lru_list::iterator i = _lru.begin(); i != _lru.end(); i++)
+      SDL_FreeSurface(i->surface);
+
+   _lru.clear();
+   _lookup.clear();
+   _bytes = 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef TEXTCACHE_H_
+#define TEXTCACHE_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+#include <string>
+#include <list>
+#include <map>
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Cache of rendered text surfaces.  Surfaces are keyed by the text, font and
+ * color used to render them.  When the cache grows past its memory budget the
+ * least recently used surfaces are freed.
+ */
+class text_cache {
+private:
+   struct key {
+      string text;
+      TTF_Font* font;
+      Uint32 color;
+
+      bool operator<(const key& other) const
+      {
+         if (font != other.font) return font < other.font;
+         if (color != other.color) return color < other.color;
+         return text < other.text;
+      }
+   };
+
+   struct entry {
+      key k;
+      SDL_Surface* surface;
+      size_t bytes;
+   };
+
+   typedef list<entry> lru_list;
+   typedef map<key, lru_list::iterator> lookup_map;
+
+   lru_list _lru;      // most recently used at the front
+   lookup_map _lookup;
+
+   size_t _budget; // maximum number of bytes held by cached surfaces
+   size_t _bytes;  // number of bytes currently held
+
+   /** Free least recently used surfaces until the cache is within budget */
+   void evict();
+
+public:
+   /** Creates a cache that holds at most budget bytes of surfaces */
+   text_cache(size_t budget);
+
+   /** Frees all cached surfaces */
+   ~text_cache();
+
+   /**
+    * Returns the text rendered with the given font and color.  The surface
+    * is owned by the cache and must not be freed by the caller.  It is only
+    * guaranteed to stay valid until the next call to render.
+    */
+   SDL_Surface* render(TTF_Font* font, const char* text, SDL_Color color);
+
+   /** Frees all cached surfaces */
+   void clear();
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <config.h>
+#include "thumbstore.h"
+#include "options.h"
+#include "log.h"
+
+#include <cstring>
+#include <sstream>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define THUMB_MAGIC "LLTHUMB"
+#define THUMB_VERSION 2
+
+/* pixel blocks start on this boundary in the data file */
+#define BLOCK_ALIGN 16
+
+/* the data file is mapped in multiples of this many bytes */
+#define MAP_CHUNK (16 << 20)
+
+/* replaced snapshots may take this many bytes before compacting */
+#define COMPACT_MIN (16 << 20)
+
+using namespace ll;
+using namespace std;
+
+/**
+ * Header at the start of the data and index files, followed by the format
+ * key padded to a multiple of 8 bytes.
+ */
+struct file_header {
+   char magic[8];
+   Uint32 version;
+   Uint32 key_len;
+};
+
+/**
+ * Entry of the index file, followed by the rom name padded to a multiple
+ * of 8 bytes.
+ */
+struct index_entry {
+   Uint32 name_len;
+   Uint32 w, h;
+   Uint32 reserved;
+   Sint64 stamp;
+   Uint64 offset;
+};
+
+static inline Uint64 pad8(Uint64 n)
+{ return (n + 7) & ~(Uint64)7; }
+
+static inline Uint64 align_block(Uint64 n)
+{ return (n + BLOCK_ALIGN - 1) & ~(Uint64)(BLOCK_ALIGN - 1); }
+
+thumb_store::thumb_store(int w, int h, const string& key,
+      Uint32 rmask, Uint32 gmask, Uint32 bmask) :
+   _key(key), _rmask(rmask), _gmask(gmask), _bmask(bmask),
+   _data_fd(-1), _index_fd(-1), _data_size(0), _dead(0)
+{
+   _lock = SDL_CreateMutex();
+
+#ifdef HAVE_SYS_MMAN_H
+   ostringstream name;
+   name << "thumbs-" << w << 'x' << h;
+
+   _data_file = name.str() + ".dat";
+   _index_file = name.str() + ".idx";
+   g_opts.resolve(_data_file);
+   g_opts.resolve(_index_file);
+
+   bool data_fresh = false, index_fresh = false;
+   _data_fd = open_file(_data_file, data_fresh);
+   _index_fd = open_file(_index_file, index_fresh);
+
+   if (_data_fd == -1 || _index_fd == -1) {
+      log << warn << "thumb_store: unable to open " << _data_file << endl;
+      close();
+      return;
+   }
+
+   // one file without the other is useless, start both over
+   if (data_fresh != index_fresh) {
+      ::close(_data_fd);
+      ::close(_index_fd);
+      unlink(_data_file.c_str());
+      unlink(_index_file.c_str());
+
+      _data_fd = open_file(_data_file, data_fresh);
+      _index_fd = open_file(_index_file, index_fresh);
+
+      if (_data_fd == -1 || _index_fd == -1) {
+         close();
+         return;
+      }
+   }
+
+   struct stat st;
+   fstat(_data_fd, &st);
+   _data_size = st.st_size;
+
+   read_index();
+
+   log << info << "thumb_store: " << _index.size() << " snapshots in "
+       << _data_file << endl;
+#else
+   log << info << "thumb_store: not supported on this platform" << endl;
+#endif
+}
+
+thumb_store::~thumb_store()
+{
+   close();
+
+#ifdef HAVE_SYS_MMAN_H
+   for (vector<mapping>::iterator i = _maps.begin(); i != _maps.end(); i++)
+      munmap(i->addr, i->length);
+   for (vector<mapping>::iterator i = _retired.begin(); i != _retired.end(); i++)
+      munmap(i->addr, i->length);
+#endif
+
+   SDL_DestroyMutex(_lock);
+}
+
+int thumb_store::open_file(const string& path, bool& fresh)
+{
+#ifdef HAVE_SYS_MMAN_H
+   int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+   if (fd == -1)
+      return -1;
+
+   size_t key_len = pad8(_key.length());
+   vector<char> expect(sizeof(file_header) + key_len, 0);
+
+   file_header* header = (file_header*)&expect[0];
+   strncpy(header->magic, THUMB_MAGIC, sizeof(header->magic));
+   header->version = THUMB_VERSION;
+   header->key_len = _key.length();
+   memcpy(&expect[sizeof(file_header)], _key.data(), _key.length());
+
+   vector<char> actual(expect.size(), 0);
+   ssize_t n = pread(fd, &actual[0], actual.size(), 0);
+
+   fresh = n != (ssize_t)actual.size() || actual != expect;
+
+   if (fresh) {
+      // missing, from an older version or prepared differently
+      if (ftruncate(fd, 0) != 0 ||
+            pwrite(fd, &expect[0], expect.size(), 0) != (ssize_t)expect.size()) {
+         ::close(fd);
+         return -1;
+      }
+   }
+
+   return fd;
+#else
+   return -1;
+#endif
+}
+
+void thumb_store::read_index()
+{
+#ifdef HAVE_SYS_MMAN_H
+   struct stat st;
+   if (fstat(_index_fd, &st) != 0)
+      return;
+
+   vector<char> buf(st.st_size);
+   if (buf.empty() || pread(_index_fd, &buf[0], buf.size(), 0) != (ssize_t)buf.size())
+      return;
+
+   size_t pos = sizeof(file_header) + pad8(_key.length());
+
+   while (pos + sizeof(index_entry) <= buf.size()) {
+      index_entry e;
+      memcpy(&e, &buf[pos], sizeof(e));
+      pos += sizeof(e);
+
+      // stop at a partially written entry
+      if (pos + pad8(e.name_len) > buf.size())
+         break;
+
+      string rom(&buf[pos], e.name_len);
+      pos += pad8(e.name_len);
+
+      // skip entries whose pixels didn't make it to the data file
+      if (e.offset + (Uint64)e.w * e.h * 4 > _data_size)
+         continue;
+
+      // later entries replace earlier ones for the same rom
+      block& b = _index[rom];
+      b.stamp = e.stamp;
+      b.offset = e.offset;
+      b.w = e.w;
+      b.h = e.h;
+   }
+
+   // whatever the current snapshots don't take was replaced
+   Uint64 live = sizeof(file_header) + pad8(_key.length());
+   for (index_map::iterator i = _index.begin(); i != _index.end(); i++)
+      live += align_block((Uint64)i->second.w * i->second.h * 4);
+   _dead = _data_size > live? _data_size - live : 0;
+#endif
+}
+
+const Uint8* thumb_store::map_data(Uint64 offset, Uint64 length)
+{
+#ifdef HAVE_SYS_MMAN_H
+   if (offset + length > _data_size)
+      return NULL;
+
+   if (_maps.empty() || offset + length > _maps.back().length) {
+      if (_data_fd == -1)
+         return NULL;
+
+      // map past the end of the file, at least twice the last mapping, so
+      // snapshots added later are covered without mapping again.  Older
+      // mappings are kept for surfaces that still point into them, at most
+      // as much again as the latest one.
+      Uint64 size = _maps.empty()? _data_size : _maps.back().length * 2;
+      if (size < _data_size) size = _data_size;
+      size = (size + MAP_CHUNK - 1) / MAP_CHUNK * MAP_CHUNK;
+
+      void* addr = mmap(NULL, size, PROT_READ, MAP_SHARED, _data_fd, 0);
+      if (addr == MAP_FAILED)
+         return NULL;
+
+      mapping m;
+      m.addr = addr;
+      m.length = size;
+      _maps.push_back(m);
+   }
+
+   return (const Uint8*)_maps.back().addr + offset;
+#else
+   return NULL;
+#endif
+}
+
+SDL_Surface* thumb_store::find(const string& rom, Sint64 stamp)
+{
+   SDL_Surface* surface = NULL;
+
+   SDL_mutexP(_lock);
+
+   index_map::iterator i = _index.find(rom);
+   if (i != _index.end() && i->second.stamp == stamp) {
+      block& b = i->second;
+      const Uint8* pixels = map_data(b.offset, (Uint64)b.w * b.h * 4);
+
+      // pixels are never written through the surface, so the read-only
+      // mapping can be used directly
+      if (pixels) {
+         surface = SDL_CreateRGBSurfaceFrom((void*)pixels, b.w, b.h, 32,
+               b.w * 4, _rmask, _gmask, _bmask, 0x00000000);
+      }
+   }
+
+   SDL_mutexV(_lock);
+
+   return surface;
+}
+
+void thumb_store::add(const string& rom, Sint64 stamp, SDL_Surface* surface)
+{
+#ifdef HAVE_SYS_MMAN_H
+   if (surface->format->BitsPerPixel != 32)
+      return;
+
+   SDL_mutexP(_lock);
+
+   if (_data_fd == -1) {
+      SDL_mutexV(_lock);
+      return;
+   }
+
+   const Uint64 row = surface->w * 4;
+   const Uint64 offset = align_block(_data_size);
+
+   bool ok = true;
+   for (int y = 0; y < surface->h && ok; y++) {
+      const Uint8* p = (const Uint8*)surface->pixels + y * surface->pitch;
+      ok = pwrite(_data_fd, p, row, offset + y * row) == (ssize_t)row;
+   }
+
+   block added;
+   added.stamp = stamp;
+   added.offset = offset;
+   added.w = surface->w;
+   added.h = surface->h;
+
+   // pixels go first so a crash never leaves an entry without its pixels
+   if (ok) {
+      off_t end = lseek(_index_fd, 0, SEEK_END);
+      ok = end != -1 && write_entry(_index_fd, end, rom, added);
+   }
+
+   if (ok) {
+      _data_size = offset + row * surface->h;
+
+      index_map::iterator i = _index.find(rom);
+      if (i != _index.end()) {
+         _dead += align_block((Uint64)i->second.w * i->second.h * 4);
+         i->second = added;
+      } else {
+         _index[rom] = added;
+      }
+
+      if (_dead > COMPACT_MIN && _dead > _data_size / 2)
+         compact();
+   } else {
+      // out of space or similar, stop writing but keep serving
+      ::close(_index_fd);
+      ::close(_data_fd);
+      _index_fd = _data_fd = -1;
+   }
+
+   SDL_mutexV(_lock);
+#endif
+}
+
+bool thumb_store::write_entry(int fd, Uint64 offset, const string& rom,
+      const block& b)
+{
+#ifdef HAVE_SYS_MMAN_H
+   vector<char> buf(sizeof(index_entry) + pad8(rom.length()), 0);
+
+   index_entry* e = (index_entry*)&buf[0];
+   e->name_len = rom.length();
+   e->w = b.w;
+   e->h = b.h;
+   e->stamp = b.stamp;
+   e->offset = b.offset;
+   memcpy(&buf[sizeof(index_entry)], rom.data(), rom.length());
+
+   return pwrite(fd, &buf[0], buf.size(), offset) == (ssize_t)buf.size();
+#else
+   return false;
+#endif
+}
+
+void thumb_store::compact()
+{
+#ifdef HAVE_SYS_MMAN_H
+   string data_tmp(_data_file + ".tmp");
+   string index_tmp(_index_file + ".tmp");
+   unlink(data_tmp.c_str());
+   unlink(index_tmp.c_str());
+
+   bool fresh;
+   int data_fd = open_file(data_tmp, fresh);
+   int index_fd = open_file(index_tmp, fresh);
+
+   const Uint64 start = sizeof(file_header) + pad8(_key.length());
+   Uint64 data_size = start;
+   Uint64 index_size = start;
+   index_map index;
+
+   bool ok = data_fd != -1 && index_fd != -1;
+   for (index_map::iterator i = _index.begin(); i != _index.end() && ok; i++) {
+      block b = i->second;
+      const Uint64 length = (Uint64)b.w * b.h * 4;
+      const Uint8* pixels = map_data(b.offset, length);
+      if (!pixels)
+         continue;
+
+      b.offset = align_block(data_size);
+      ok = pwrite(data_fd, pixels, length, b.offset) == (ssize_t)length &&
+         write_entry(index_fd, index_size, i->first, b);
+
+      data_size = b.offset + length;
+      index_size += sizeof(index_entry) + pad8(i->first.length());
+      index[i->first] = b;
+   }
+
+   // without the index a crash between the renames leaves the data file
+   // alone, which is noticed and started over when the store is opened
+   ok = ok && unlink(_index_file.c_str()) == 0 &&
+      rename(data_tmp.c_str(), _data_file.c_str()) == 0 &&
+      rename(index_tmp.c_str(), _index_file.c_str()) == 0;
+
+   if (!ok) {
+      if (data_fd != -1) ::close(data_fd);
+      if (index_fd != -1) ::close(index_fd);
+      unlink(data_tmp.c_str());
+      unlink(index_tmp.c_str());
+      return;
+   }
+
+   close();
+   _data_fd = data_fd;
+   _index_fd = index_fd;
+   _data_size = data_size;
+   _dead = 0;
+   _index.swap(index);
+
+   // surfaces may still point into the old file, its mappings stay
+   _retired.insert(_retired.end(), _maps.begin(), _maps.end());
+   _maps.clear();
+#endif
+}
+
+size_t thumb_store::size()
+{
+   SDL_mutexP(_lock);
+   size_t n = _index.size();
+   SDL_mutexV(_lock);
+
+   return n;
+}
+
+void thumb_store::close()
+{
+#ifdef HAVE_SYS_MMAN_H
+   if (_data_fd != -1)
+      ::close(_data_fd);
+
+   if (_index_fd != -1)
+      ::close(_index_fd);
+#endif
+
+   _data_fd = _index_fd = -1;
+}
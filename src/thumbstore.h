@@ -0,0 +1,143 @@
+/*
+ * Copyright 2007 Josh Kropf
+ *
+ * This file is part of Lemon Launcher.
+ *
+ * Lemon Launcher is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lemon Launcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Lemon Launcher; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef THUMBSTORE_H_
+#define THUMBSTORE_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_mutex.h>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+namespace ll {
+
+/**
+ * Persistent store of prepared snapshots (scaled, faded and in the drawing
+ * buffer format) so they never have to be decoded again.
+ *
+ * Pixels are appended to a packed data file that is memory mapped, and
+ * surfaces handed out point straight into the mapping.  A separate index
+ * file maps rom names to pixel blocks along with the modification stamp
+ * of the source image, so stale entries are ignored when a snap changes.
+ * Once replaced snapshots make up most of the data file, both files are
+ * rewritten with only the current ones.
+ *
+ * Both files start with a format key describing how the snapshots were
+ * prepared (see lemonui::snap_format).  When the key doesn't match, for
+ * example because the theme snapshot area changed, the store is emptied.
+ *
+ * All methods are safe to call from several threads.
+ */
+class thumb_store {
+private:
+   struct block {
+      Sint64 stamp;    // modification stamp of the source image
+      Uint64 offset;   // offset of the pixels in the data file
+      Uint32 w, h;
+   };
+
+   typedef map<string, block> index_map;
+
+   SDL_mutex* _lock;
+   string _key;     // format key the stored snapshots were prepared with
+   Uint32 _rmask, _gmask, _bmask;
+
+   string _data_file;
+   string _index_file;
+   int _data_fd;
+   int _index_fd;
+   Uint64 _data_size;
+   Uint64 _dead;    // bytes of the data file taken by replaced snapshots
+   index_map _index;
+
+   /*
+    * mappings of the data file, older ones stay valid for surfaces in use.
+    * The latest one reaches past the end of the file, only the part up to
+    * _data_size is ever read.
+    */
+   struct mapping {
+      void* addr;
+      size_t length;
+   };
+   vector<mapping> _maps;
+   vector<mapping> _retired; // mappings of data files replaced by compact
+
+   /** Opens a file and checks its header, emptying it on mismatch */
+   int open_file(const string& path, bool& fresh);
+
+   /** Reads the index file into memory */
+   void read_index();
+
+   /** Returns a pointer to data file bytes, mapping more of it if needed */
+   const Uint8* map_data(Uint64 offset, Uint64 length);
+
+   /** Writes the index entry of a block at the given offset of a file */
+   static bool write_entry(int fd, Uint64 offset, const string& rom,
+         const block& b);
+
+   /**
+    * Rewrites the data and index files with only the current snapshots.
+    * The old files are kept on failure.
+    */
+   void compact();
+
+   /** Closes files and unmaps the data file */
+   void close();
+
+public:
+   /**
+    * Opens (or creates) the store named after the snapshot size in the
+    * conf dir.  When the files can't be used the store stays empty and
+    * find/add do nothing.
+    * @param w,h snapshot area dimensions
+    * @param key format key of prepared snapshots
+    * @param rmask,gmask,bmask color masks of prepared snapshots
+    */
+   thumb_store(int w, int h, const string& key,
+         Uint32 rmask, Uint32 gmask, Uint32 bmask);
+
+   /** Unmaps the data file, surfaces from find must be freed before this */
+   ~thumb_store();
+
+   /** Returns true if the store files are open */
+   bool is_open() const
+   { return _data_fd != -1; }
+
+   /**
+    * Looks up the stored snapshot of a rom.  The returned surface points
+    * into the read-only mapping of the data file.
+    * @param stamp modification stamp of the source image, entries with a
+    * different stamp are stale
+    * @return newly created surface, or NULL if not stored
+    */
+   SDL_Surface* find(const string& rom, Sint64 stamp);
+
+   /** Appends a prepared snapshot to the store */
+   void add(const string& rom, Sint64 stamp, SDL_Surface* surface);
+
+   /** Returns the number of snapshots in the store */
+   size_t size();
+};
+
+} // end namespace
+
+#endif